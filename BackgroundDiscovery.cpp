@@ -0,0 +1,244 @@
+#include "stdafx.h"
+#include "BackgroundDiscovery.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace Info
+{
+	class BackgroundDiscovery::State
+	{
+	public:
+		State( const cl_device_type type, const DiscoveryMode mode):
+			future( promise.get_future().share()),
+			type( type),
+			mode( mode),
+			error( CL_SUCCESS),
+			cancelled( false),
+			finished( false)
+		{}
+
+		// held while listeners run
+		std::recursive_mutex				publishMutex;
+		std::mutex							dataMutex;
+		std::vector<DiscoveryListener*>		listeners;
+		PlatformRecordArray					platforms;
+		std::promise<cl_int>				promise;
+		std::shared_future<cl_int>			future;
+		cl_device_type						type;
+		DiscoveryMode						mode;
+		cl_int								error;
+		std::atomic<bool>					cancelled;
+		bool								finished;
+	};
+
+	BackgroundDiscovery::BackgroundDiscovery( const cl_device_type type, const DiscoveryMode mode):
+		iState( std::make_shared<State>( type, mode))
+	{}
+
+	BackgroundDiscovery::~BackgroundDiscovery()
+	{
+		cancel();
+		if ( iThread.joinable())
+		{
+			if ( isFinished())
+			{
+				iThread.join();
+			}
+			else
+			{
+				iThread.detach();
+			}
+		}
+	}
+
+	void BackgroundDiscovery::subscribe( DiscoveryListener* const listener)
+	{
+		std::lock_guard<std::recursive_mutex> publishLock( iState->publishMutex);
+
+		PlatformRecordArray platforms;
+		bool finished;
+		cl_int error;
+		{
+			std::lock_guard<std::mutex> lock( iState->dataMutex);
+			platforms = iState->platforms;
+			finished = iState->finished;
+			error = iState->error;
+		}
+
+		for ( auto i = platforms.begin(); i != platforms.end(); ++i)
+		{
+			PlatformRecord record = *i;
+			record.devices().clear();
+			listener->platformFound( record);
+
+			for ( auto j = i->devices().begin(); j != i->devices().end(); ++j)
+			{
+				record.devices().push_back( *j);
+				listener->deviceFound( record, *j);
+			}
+		}
+
+		if ( finished)
+		{
+			listener->finished( error);
+		}
+
+		iState->listeners.push_back( listener);
+	}
+
+	void BackgroundDiscovery::unsubscribe( DiscoveryListener* const listener)
+	{
+		std::lock_guard<std::recursive_mutex> publishLock( iState->publishMutex);
+		auto& listeners = iState->listeners;
+		listeners.erase( std::remove( listeners.begin(), listeners.end(), listener), listeners.end());
+	}
+
+	void BackgroundDiscovery::start()
+	{
+		if ( !iThread.joinable())
+		{
+			iThread = std::thread( &BackgroundDiscovery::work, iState);
+		}
+	}
+
+	void BackgroundDiscovery::cancel()
+	{
+		std::lock_guard<std::recursive_mutex> publishLock( iState->publishMutex);
+		iState->cancelled = true;
+	}
+
+	bool BackgroundDiscovery::wait( const unsigned int milliseconds) const
+	{
+		return iState->future.wait_for( std::chrono::milliseconds( milliseconds)) == std::future_status::ready;
+	}
+
+	bool BackgroundDiscovery::isFinished() const
+	{
+		std::lock_guard<std::mutex> lock( iState->dataMutex);
+		return iState->finished;
+	}
+
+	bool BackgroundDiscovery::isCancelled() const
+	{
+		return iState->cancelled;
+	}
+
+	std::shared_future<cl_int> BackgroundDiscovery::result() const
+	{
+		return iState->future;
+	}
+
+	void BackgroundDiscovery::snapshot( PlatformRecordArray& platforms) const
+	{
+		std::lock_guard<std::mutex> lock( iState->dataMutex);
+		platforms = iState->platforms;
+	}
+
+	void BackgroundDiscovery::work( const std::shared_ptr<State> state)
+	{
+		cl_int error = CL_SUCCESS;
+
+		std::vector<cl_platform_id> platformIds;
+		{
+			cl_uint count = 0;
+			error = clGetPlatformIDs( 0, nullptr, &count);
+			if ( !error && count)
+			{
+				platformIds.resize( count);
+				error = clGetPlatformIDs( count, &platformIds[ 0], nullptr);
+			}
+		}
+
+		// discovery is best effort: a failing platform or device is skipped and the first failure reported
+		cl_int failure = CL_SUCCESS;
+		DeviceRecordMap known;
+		for ( size_t p = 0; p < platformIds.size() && !state->cancelled; ++p)
+		{
+			PlatformRecord record;
+			record.setId( platformIds[ p]);
+			{
+				Platform platform;
+				const auto platformError = read( platform, platformIds[ p]);
+				if ( platformError)
+				{
+					failure = failure ? failure : platformError;
+					continue;
+				}
+
+				record.setPlatform( platform);
+			}
+
+			// data and notification under one publishMutex hold, so a subscribe() in between neither misses nor repeats the record
+			size_t index;
+			{
+				std::lock_guard<std::recursive_mutex> publishLock( state->publishMutex);
+				{
+					std::lock_guard<std::mutex> lock( state->dataMutex);
+					index = state->platforms.size();
+					state->platforms.push_back( record);
+				}
+
+				for ( size_t i = 0; i < state->listeners.size() && !state->cancelled; ++i)
+				{
+					state->listeners[ i]->platformFound( record);
+				}
+			}
+
+			std::vector<cl_device_id> deviceIds;
+			{
+				cl_uint count = 0;
+				if ( !clGetDeviceIDs( platformIds[ p], state->type, 0, nullptr, &count) && count)
+				{
+					deviceIds.resize( count);
+					if ( clGetDeviceIDs( platformIds[ p], state->type, count, &deviceIds[ 0], nullptr))
+					{
+						deviceIds.clear();
+					}
+				}
+			}
+
+			for ( size_t d = 0; d < deviceIds.size() && !state->cancelled; ++d)
+			{
+				DeviceInstance instance;
+				try
+				{
+					read( instance, deviceIds[ d], state->mode, known);
+				}
+				catch( Exception& ex)
+				{
+					failure = failure ? failure : ex.error();
+					continue;
+				}
+
+				record.devices().push_back( instance);
+
+				std::lock_guard<std::recursive_mutex> publishLock( state->publishMutex);
+				{
+					std::lock_guard<std::mutex> lock( state->dataMutex);
+					state->platforms[ index].devices().push_back( instance);
+				}
+
+				for ( size_t i = 0; i < state->listeners.size() && !state->cancelled; ++i)
+				{
+					state->listeners[ i]->deviceFound( record, instance);
+				}
+			}
+		}
+
+		error = error ? error : failure;
+		std::lock_guard<std::recursive_mutex> publishLock( state->publishMutex);
+		{
+			std::lock_guard<std::mutex> lock( state->dataMutex);
+			state->finished = true;
+			state->error = error;
+		}
+
+		state->promise.set_value( error);
+		for ( size_t i = 0; i < state->listeners.size() && !state->cancelled; ++i)
+		{
+			state->listeners[ i]->finished( error);
+		}
+	}
+}
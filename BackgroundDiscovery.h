@@ -0,0 +1,62 @@
+#pragma once
+#ifndef PCHDR
+	#include "Discovery.h"
+	#include <future>
+	#include <memory>
+	#include <thread>
+#endif
+
+namespace Info
+{
+	class DiscoveryListener
+	{
+	public:
+		virtual ~DiscoveryListener() {}
+
+		// called from the discovery thread; the platform record has no devices yet
+		virtual void platformFound( const PlatformRecord& platform) {}
+		virtual void deviceFound( const PlatformRecord& platform, const DeviceInstance& device) {}
+		virtual void finished( const cl_int error) {}
+	};
+
+	class BackgroundDiscovery
+	{
+	public:
+		explicit BackgroundDiscovery( const cl_device_type type = CL_DEVICE_TYPE_ALL, const DiscoveryMode mode = dmDeduplicate);
+
+		// cancels; a thread stuck in the driver is detached rather than joined
+		~BackgroundDiscovery();
+
+		// replays everything already published to the new listener
+		void subscribe( DiscoveryListener* const listener);
+		void unsubscribe( DiscoveryListener* const listener);
+
+		void start();
+
+		// no listener is called once this returns
+		void cancel();
+
+		// true when discovery finished within the timeout
+		bool wait( const unsigned int milliseconds) const;
+
+		bool isFinished() const;
+		bool isCancelled() const;
+
+		// resolves to the first error, or CL_SUCCESS
+		std::shared_future<cl_int> result() const;
+
+		// platforms and devices published so far
+		void snapshot( PlatformRecordArray& platforms) const;
+
+	private:
+		BackgroundDiscovery( const BackgroundDiscovery&);
+		BackgroundDiscovery& operator=( const BackgroundDiscovery&);
+
+		class State;
+
+		static void work( const std::shared_ptr<State> state);
+
+		std::shared_ptr<State>	iState;
+		std::thread				iThread;
+	};
+}
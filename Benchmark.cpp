@@ -0,0 +1,352 @@
+#include "stdafx.h"
+#include "Benchmark.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+
+#ifdef _WIN32
+	#include <windows.h>
+	#include <powrprof.h>
+	#pragma comment( lib, "powrprof.lib")
+#endif
+
+namespace Info
+{
+	namespace
+	{
+		// scales the MAD to the standard deviation of a normal distribution
+		const double madScale = 1.4826;
+
+	#ifdef _WIN32
+		// documented for CallNtPowerInformation but not declared by the SDK headers
+		struct ProcessorPowerInformation
+		{
+			ULONG number;
+			ULONG maxMhz;
+			ULONG currentMhz;
+			ULONG mhzLimit;
+			ULONG maxIdleState;
+			ULONG currentIdleState;
+		};
+
+		std::string readRegistryString( const HKEY root, const char* const path, const char* const name)
+		{
+			HKEY key;
+			if ( RegOpenKeyExA( root, path, 0, KEY_READ, &key) != ERROR_SUCCESS)
+			{
+				return std::string();
+			}
+
+			char buffer[ 256];
+			DWORD size = sizeof(buffer) - 1;
+			DWORD type = 0;
+			const auto status = RegQueryValueExA( key, name, nullptr, &type, reinterpret_cast<BYTE*>( buffer), &size);
+			RegCloseKey( key);
+			if ( status != ERROR_SUCCESS || type != REG_SZ)
+			{
+				return std::string();
+			}
+
+			buffer[ size] = 0;
+			return buffer;
+		}
+	#else
+		std::string readLine( const char* const path)
+		{
+			std::ifstream file( path);
+			std::string line;
+			std::getline( file, line);
+			return line;
+		}
+
+		unsigned int readMegahertz( const char* const path)
+		{
+			// cpufreq reports kHz
+			return static_cast<unsigned int>( strtoul( readLine( path).c_str(), nullptr, 10) / 1000);
+		}
+	#endif
+	}
+
+	HostState readHostState()
+	{
+		HostState state;
+	#ifdef _WIN32
+		SYSTEM_INFO system;
+		GetSystemInfo( &system);
+
+		std::vector<ProcessorPowerInformation> processors( system.dwNumberOfProcessors);
+		if ( !processors.empty() && !CallNtPowerInformation( ProcessorInformation, nullptr, 0, &processors[ 0], static_cast<ULONG>( processors.size() * sizeof(ProcessorPowerInformation))))
+		{
+			state.setCpuFrequency( processors[ 0].currentMhz);
+			state.setMaxCpuFrequency( processors[ 0].maxMhz);
+		}
+
+		state.setGovernor( readRegistryString( HKEY_LOCAL_MACHINE, "SYSTEM\\CurrentControlSet\\Control\\Power\\User\\PowerSchemes", "ActivePowerScheme"));
+	#else
+		state.setCpuFrequency( readMegahertz( "/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq"));
+		state.setMaxCpuFrequency( readMegahertz( "/sys/devices/system/cpu/cpu0/cpufreq/cpuinfo_max_freq"));
+		state.setGovernor( readLine( "/sys/devices/system/cpu/cpu0/cpufreq/scaling_governor"));
+	#endif
+		return state;
+	}
+
+	double median( std::vector<double> samples)
+	{
+		if ( samples.empty())
+		{
+			return 0.0;
+		}
+
+		const auto middle = samples.begin() + samples.size() / 2;
+		std::nth_element( samples.begin(), middle, samples.end());
+		if ( samples.size() % 2)
+		{
+			return *middle;
+		}
+
+		return ( *middle + *std::max_element( samples.begin(), middle)) / 2.0;
+	}
+
+	double medianAbsoluteDeviation( const std::vector<double>& samples)
+	{
+		const auto center = median( samples);
+		std::vector<double> deviations( samples.size());
+		for ( size_t i = 0; i < samples.size(); ++i)
+		{
+			deviations[ i] = fabs( samples[ i] - center);
+		}
+
+		return median( deviations);
+	}
+
+	size_t rejectOutliers( std::vector<double>& samples, const double threshold)
+	{
+		const auto center = median( samples);
+		const auto spread = madScale * medianAbsoluteDeviation( samples);
+		if ( spread <= 0.0)
+		{
+			return 0;
+		}
+
+		const auto size = samples.size();
+		samples.erase( std::remove_if( samples.begin(), samples.end(), [=]( const double sample) { return fabs( sample - center) / spread > threshold; }), samples.end());
+		return size - samples.size();
+	}
+
+	double medianConfidence( std::vector<double> samples)
+	{
+		const auto n = samples.size();
+		if ( n < 2)
+		{
+			return 1.0;
+		}
+
+		std::sort( samples.begin(), samples.end());
+
+		// order statistics bounding the median with 95% coverage
+		const double spread = 0.98 * sqrt( static_cast<double>( n));
+		const auto lower = static_cast<size_t>( std::max( 0.0, floor( n / 2.0 - spread)));
+		const auto upper = std::min( n - 1, static_cast<size_t>( ceil( n / 2.0 + spread)));
+		const auto center = median( samples);
+		return center > 0.0 ? ( samples[ upper] - samples[ lower]) / 2.0 / center : 1.0;
+	}
+
+	void write( std::ostream& stream, const BenchmarkResult& result)
+	{
+		stream << "median " << result.median() << " ns, MAD " << result.mad() << " ns, +/-" << result.confidence() * 100.0 << "% (" <<
+			result.samples().size() << " samples, " << result.outliers() << " outliers, " << result.warmupRuns() << " warm-up, " <<
+			result.deviceTimed() << " device timed" << ( result.isConverged() ? "" : ", not converged") << ')';
+
+		const auto& before = result.hostBefore();
+		const auto& after = result.hostAfter();
+		if ( before.cpuFrequency() || after.cpuFrequency())
+		{
+			stream << " cpu " << before.cpuFrequency() << "->" << after.cpuFrequency() << '/' << after.maxCpuFrequency() << " MHz";
+		}
+
+		if ( !after.governor().empty())
+		{
+			stream << ' ' << after.governor();
+		}
+	}
+
+	bool Benchmark::interval( double& host, double& device, const cl_event event, const unsigned long long hostStart) const
+	{
+		device = -1.0;
+		if ( clWaitForEvents( 1, &event))
+		{
+			return false;
+		}
+
+		host = static_cast<double>( Trace::now() - hostStart);
+
+		// a device interval longer than the host one means the clocks disagree
+		cl_ulong start = 0, end = 0;
+		if ( !clGetEventProfilingInfo( event, CL_PROFILING_COMMAND_START, sizeof(start), &start, nullptr) &&
+			!clGetEventProfilingInfo( event, CL_PROFILING_COMMAND_END, sizeof(end), &end, nullptr) && end >= start &&
+			static_cast<double>( end - start) <= host + std::max<size_t>( iResolution, 1))
+		{
+			device = static_cast<double>( end - start);
+		}
+
+		return true;
+	}
+
+	bool Benchmark::resolves( const double device) const
+	{
+		return device >= static_cast<double>( std::max<size_t>( iResolution, 1)) * iSettings.resolutionMultiple();
+	}
+
+	bool Benchmark::time( double& nanoseconds, bool& fromDevice, const cl_event event, const unsigned long long hostStart) const
+	{
+		double device;
+		if ( !interval( nanoseconds, device, event, hostStart))
+		{
+			return false;
+		}
+
+		fromDevice = resolves( device);
+		nanoseconds = fromDevice ? device : nanoseconds;
+		return true;
+	}
+
+	BenchmarkResult Benchmark::run( const Enqueue& enqueue) const
+	{
+		return measure( [&]( double& host, double& device) -> bool
+		{
+			const auto start = Trace::now();
+			const auto event = enqueue();
+			if ( !event)
+			{
+				return false;
+			}
+
+			const bool timed = interval( host, device, event, start);
+			clReleaseEvent( event);
+			return timed;
+		});
+	}
+
+	BenchmarkResult Benchmark::runHost( const Work& work) const
+	{
+		return measure( [&]( double& host, double& device) -> bool
+		{
+			device = -1.0;
+			const auto start = Trace::now();
+			if ( !work())
+			{
+				return false;
+			}
+
+			host = static_cast<double>( Trace::now() - start);
+			return true;
+		});
+	}
+
+	BenchmarkResult Benchmark::measure( const Sampler& sample) const
+	{
+		BenchmarkResult result;
+		result.setHostBefore( readHostState());
+		const auto start = Trace::now();
+		const auto limit = static_cast<unsigned long long>( iSettings.timeLimit() * 1e9);
+
+		// caches, clocks and lazy driver work settle during the first runs, which also pick the clock:
+		// the device one only when it resolves every run, so the samples never mix two quantities
+		bool fromDevice = true;
+		{
+			std::vector<double> window;
+			double previous = 0.0;
+			unsigned int runs = 0;
+			while ( runs < iSettings.warmupLimit())
+			{
+				double host, device;
+				if ( !sample( host, device))
+				{
+					return result;
+				}
+
+				++runs;
+				fromDevice = fromDevice && resolves( device);
+				window.push_back( device >= 0.0 ? device : host);
+				if ( window.size() < std::max( iSettings.warmupWindow(), 1u))
+				{
+					continue;
+				}
+
+				const auto current = median( window);
+				window.clear();
+				if ( previous > 0.0 && fabs( current - previous) <= iSettings.warmupTolerance() * previous)
+				{
+					break;
+				}
+
+				previous = current;
+			}
+
+			fromDevice = fromDevice && runs > 0;
+			result.setWarmupRuns( runs);
+		}
+
+		std::vector<double> samples;
+		std::vector<double> accepted;
+		unsigned int skipped = 0;
+		while ( samples.size() < iSettings.maxSamples())
+		{
+			double host, device;
+			if ( !sample( host, device))
+			{
+				break;
+			}
+
+			// a device timed run without a usable interval is dropped rather than replaced by host time
+			if ( fromDevice && device < 0.0)
+			{
+				if ( ++skipped >= iSettings.maxSamples() || Trace::now() - start > limit)
+				{
+					break;
+				}
+
+				continue;
+			}
+
+			samples.push_back( fromDevice ? device : host);
+			if ( samples.size() < iSettings.minSamples())
+			{
+				continue;
+			}
+
+			accepted = samples;
+			rejectOutliers( accepted, iSettings.outlierThreshold());
+			if ( medianConfidence( accepted) <= iSettings.confidenceTarget())
+			{
+				result.setConverged( true);
+				break;
+			}
+
+			if ( Trace::now() - start > limit)
+			{
+				break;
+			}
+		}
+
+		if ( samples.size() < iSettings.minSamples())
+		{
+			accepted = samples;
+			rejectOutliers( accepted, iSettings.outlierThreshold());
+		}
+
+		if ( !accepted.empty())
+		{
+			result.setMedian( median( accepted));
+			result.setMad( medianAbsoluteDeviation( accepted));
+			result.setMinimum( *std::min_element( accepted.begin(), accepted.end()));
+			result.setConfidence( medianConfidence( accepted));
+		}
+
+		result.setOutliers( static_cast<unsigned int>( samples.size() - accepted.size()));
+		result.setDeviceTimed( fromDevice ? static_cast<unsigned int>( samples.size()) : 0);
+		result.setSamples( accepted);
+		result.setHostAfter( readHostState());
+		return result;
+	}
+}
@@ -0,0 +1,213 @@
+#pragma once
+#ifndef PCHDR
+	#include <CL/cl.h>
+	#include <functional>
+	#include <ostream>
+	#include <string>
+	#include <vector>
+#endif
+
+namespace Info
+{
+	class HostState
+	{
+	public:
+		HostState():
+			iCpuFrequency( 0),
+			iMaxCpuFrequency( 0)
+		{}
+
+		// MHz of the first CPU; 0 when unknown
+		unsigned int cpuFrequency() const { return iCpuFrequency; }
+		void setCpuFrequency( const unsigned int value) { iCpuFrequency = value; }
+
+		unsigned int maxCpuFrequency() const { return iMaxCpuFrequency; }
+		void setMaxCpuFrequency( const unsigned int value) { iMaxCpuFrequency = value; }
+
+		// cpufreq governor on Linux, active power scheme on Windows
+		const std::string& governor() const { return iGovernor; }
+		void setGovernor( const std::string& item) { iGovernor = item; }
+
+	private:
+		std::string		iGovernor;
+		unsigned int	iCpuFrequency;
+		unsigned int	iMaxCpuFrequency;
+	};
+
+	HostState readHostState();
+
+	double median( std::vector<double> samples);
+	double medianAbsoluteDeviation( const std::vector<double>& samples);
+
+	// drops samples whose modified z-score exceeds threshold; returns how many were dropped
+	size_t rejectOutliers( std::vector<double>& samples, const double threshold);
+
+	// half-width of the distribution-free 95% confidence interval of the median, relative to the median
+	double medianConfidence( std::vector<double> samples);
+
+	class BenchmarkSettings
+	{
+	public:
+		BenchmarkSettings():
+			iConfidenceTarget( 0.02),
+			iOutlierThreshold( 3.5),
+			iWarmupTolerance( 0.05),
+			iTimeLimit( 2.0),
+			iMinSamples( 10),
+			iMaxSamples( 200),
+			iWarmupWindow( 3),
+			iWarmupLimit( 30),
+			iResolutionMultiple( 100)
+		{}
+
+		// stop once the relative confidence half-width of the median is below this
+		double confidenceTarget() const { return iConfidenceTarget; }
+		void setConfidenceTarget( const double value) { iConfidenceTarget = value; }
+
+		// modified z-score above which a sample is an outlier
+		double outlierThreshold() const { return iOutlierThreshold; }
+		void setOutlierThreshold( const double value) { iOutlierThreshold = value; }
+
+		// warm-up ends when the medians of two consecutive windows agree within this
+		double warmupTolerance() const { return iWarmupTolerance; }
+		void setWarmupTolerance( const double value) { iWarmupTolerance = value; }
+
+		// seconds; repetition stops after minSamples once this is exceeded
+		double timeLimit() const { return iTimeLimit; }
+		void setTimeLimit( const double value) { iTimeLimit = value; }
+
+		unsigned int minSamples() const { return iMinSamples; }
+		void setMinSamples( const unsigned int value) { iMinSamples = value; }
+
+		unsigned int maxSamples() const { return iMaxSamples; }
+		void setMaxSamples( const unsigned int value) { iMaxSamples = value; }
+
+		unsigned int warmupWindow() const { return iWarmupWindow; }
+		void setWarmupWindow( const unsigned int value) { iWarmupWindow = value; }
+
+		unsigned int warmupLimit() const { return iWarmupLimit; }
+		void setWarmupLimit( const unsigned int value) { iWarmupLimit = value; }
+
+		// device timestamps are trusted only for commands this many timer ticks long
+		unsigned int resolutionMultiple() const { return iResolutionMultiple; }
+		void setResolutionMultiple( const unsigned int value) { iResolutionMultiple = value; }
+
+	private:
+		double			iConfidenceTarget;
+		double			iOutlierThreshold;
+		double			iWarmupTolerance;
+		double			iTimeLimit;
+		unsigned int	iMinSamples;
+		unsigned int	iMaxSamples;
+		unsigned int	iWarmupWindow;
+		unsigned int	iWarmupLimit;
+		unsigned int	iResolutionMultiple;
+	};
+
+	class BenchmarkResult
+	{
+	public:
+		BenchmarkResult():
+			iMedian( 0.0),
+			iMad( 0.0),
+			iMinimum( 0.0),
+			iConfidence( 0.0),
+			iWarmupRuns( 0),
+			iOutliers( 0),
+			iDeviceTimed( 0),
+			iConverged( false)
+		{}
+
+		bool isValid() const { return !iSamples.empty(); }
+
+		// nanoseconds, after outlier rejection
+		const std::vector<double>& samples() const { return iSamples; }
+		void setSamples( const std::vector<double>& item) { iSamples = item; }
+
+		double median() const { return iMedian; }
+		void setMedian( const double value) { iMedian = value; }
+
+		double mad() const { return iMad; }
+		void setMad( const double value) { iMad = value; }
+
+		double minimum() const { return iMinimum; }
+		void setMinimum( const double value) { iMinimum = value; }
+
+		// relative confidence half-width of the median
+		double confidence() const { return iConfidence; }
+		void setConfidence( const double value) { iConfidence = value; }
+
+		unsigned int warmupRuns() const { return iWarmupRuns; }
+		void setWarmupRuns( const unsigned int value) { iWarmupRuns = value; }
+
+		unsigned int outliers() const { return iOutliers; }
+		void setOutliers( const unsigned int value) { iOutliers = value; }
+
+		// samples taken from profiling events rather than the host clock; all of them or none
+		unsigned int deviceTimed() const { return iDeviceTimed; }
+		void setDeviceTimed( const unsigned int value) { iDeviceTimed = value; }
+
+		// false when the sample or time limit ran out before the confidence target was met
+		bool isConverged() const { return iConverged; }
+		void setConverged( const bool value) { iConverged = value; }
+
+		const HostState& hostBefore() const { return iHostBefore; }
+		void setHostBefore( const HostState& item) { iHostBefore = item; }
+
+		const HostState& hostAfter() const { return iHostAfter; }
+		void setHostAfter( const HostState& item) { iHostAfter = item; }
+
+	private:
+		std::vector<double>	iSamples;
+		HostState			iHostBefore;
+		HostState			iHostAfter;
+		double				iMedian;
+		double				iMad;
+		double				iMinimum;
+		double				iConfidence;
+		unsigned int		iWarmupRuns;
+		unsigned int		iOutliers;
+		unsigned int		iDeviceTimed;
+		bool				iConverged;
+	};
+
+	void write( std::ostream& stream, const BenchmarkResult& result);
+
+	class Benchmark
+	{
+	public:
+		// enqueues one run and returns its event, which the harness releases; nullptr on failure
+		typedef std::function<cl_event ()> Enqueue;
+
+		// one run timed on the host only; false on failure
+		typedef std::function<bool ()> Work;
+
+		// the queue must have profiling enabled for device timing; otherwise host time is used
+		explicit Benchmark( const size_t profilingTimerResolution = 0):
+			iResolution( profilingTimerResolution)
+		{}
+
+		const BenchmarkSettings& settings() const { return iSettings; }
+		void setSettings( const BenchmarkSettings& item) { iSettings = item; }
+
+		// device timed when every warm-up run resolves on the device timer, host timed otherwise; never a mix
+		BenchmarkResult run( const Enqueue& enqueue) const;
+		BenchmarkResult runHost( const Work& work) const;
+
+		// waits for the event and prefers its profiling interval when that is long enough to resolve
+		// and consistent with the host interval since hostStart (Trace::now() clock)
+		bool time( double& nanoseconds, bool& fromDevice, const cl_event event, const unsigned long long hostStart) const;
+
+	private:
+		// host and device nanoseconds of one run; device is negative when the run has no usable profiling interval
+		typedef std::function<bool ( double&, double&)> Sampler;
+
+		bool interval( double& host, double& device, const cl_event event, const unsigned long long hostStart) const;
+		bool resolves( const double device) const;
+
+		BenchmarkResult measure( const Sampler& sample) const;
+
+		BenchmarkSettings	iSettings;
+		size_t				iResolution;
+	};
+}
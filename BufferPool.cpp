@@ -0,0 +1,347 @@
+#include "stdafx.h"
+#include "BufferPool.h"
+#include <algorithm>
+
+namespace Info
+{
+	namespace
+	{
+		// below the usual 128 byte base address alignment, so only reached for odd devices
+		const size_t minimumGranularity = 64;
+	}
+
+	void write( std::ostream& stream, const BufferPoolStatistics& statistics)
+	{
+		stream << statistics.slabCount() << " slabs, " << statistics.reserved() << " bytes reserved, " <<
+			statistics.committed() << " committed (" << statistics.requested() << " requested, high water " << statistics.highWater() << "), " <<
+			statistics.freeBytes() << " free (largest block " << statistics.largestFreeBlock() << "), " <<
+			"fragmentation " << statistics.internalFragmentation() * 100.0 << "% internal " << statistics.externalFragmentation() * 100.0 << "% external, " <<
+			statistics.allocations() << " allocations, " << statistics.slabCreations() << " buffers and " << statistics.subBufferCreations() << " sub-buffers created, " <<
+			statistics.cacheHits() << " cache hits, " << statistics.staging() << " bytes staging";
+	}
+
+	BufferPool::BufferPool( const cl_context context, const cl_command_queue queue, const Device& device, const size_t slabSize, const cl_mem_flags access):
+		iContext( context),
+		iQueue( queue),
+		iAccess( access),
+		iGranularity( std::max<size_t>( device.memoryBaseAddressAlignment() / 8, minimumGranularity)),
+		iMaxAllocation( device.maxMemoryAllocSize() ? device.maxMemoryAllocSize() : ~0ull)
+	{
+		// every block offset is then a multiple of its own size, and so of the alignment
+		const auto limit = static_cast<size_t>( std::min<ulong>( std::max( slabSize, iGranularity), iMaxAllocation));
+		uint classes = 1;
+		while ( classSize( classes) <= limit && classSize( classes) > classSize( classes - 1))
+		{
+			++classes;
+		}
+
+		iSlabSize = classSize( classes - 1);
+		iFree.resize( classes);
+		iStatistics.setSlabSize( iSlabSize);
+	}
+
+	BufferPool::~BufferPool()
+	{
+		trim();
+		for ( auto i = iSlabs.begin(); i != iSlabs.end(); ++i)
+		{
+			// slabs with live allocations stay alive until their sub-buffers are released
+			releaseCached( *i);
+		}
+	}
+
+	uint BufferPool::sizeClass( const size_t size) const
+	{
+		uint result = 0;
+		while ( classSize( result) < size)
+		{
+			++result;
+		}
+
+		return result;
+	}
+
+	void BufferPool::releaseCached( const cl_mem cached)
+	{
+		if ( cached)
+		{
+			clReleaseMemObject( cached);
+		}
+	}
+
+	uint BufferPool::addSlab()
+	{
+		cl_int error = CL_SUCCESS;
+		const auto slab = clCreateBuffer( iContext, iAccess, iSlabSize, nullptr, &error);
+		if ( error)
+		{
+			throw ApiException( "clCreateBuffer", error);
+		}
+
+		// slots of trimmed slabs are reused so indices in live allocations stay valid
+		auto index = static_cast<uint>( std::find( iSlabs.begin(), iSlabs.end(), static_cast<cl_mem>( nullptr)) - iSlabs.begin());
+		if ( index == iSlabs.size())
+		{
+			iSlabs.push_back( slab);
+		}
+		else
+		{
+			iSlabs[ index] = slab;
+		}
+
+		iFree.back()[ BlockKey( index, 0)] = nullptr;
+		iStatistics.setSlabCount( iStatistics.slabCount() + 1);
+		iStatistics.setReserved( iStatistics.reserved() + iSlabSize);
+		iStatistics.setSlabCreations( iStatistics.slabCreations() + 1);
+		return index;
+	}
+
+	bool BufferPool::take( const uint sizeClass, BlockKey& key, cl_mem& cached)
+	{
+		auto from = sizeClass;
+		while ( from < iFree.size() && iFree[ from].empty())
+		{
+			++from;
+		}
+
+		if ( from == iFree.size())
+		{
+			return false;
+		}
+
+		// lowest slab and offset first, which keeps the high end of the slabs free for merging
+		const auto first = iFree[ from].begin();
+		key = first->first;
+		cached = first->second;
+		iFree[ from].erase( first);
+
+		while ( from > sizeClass)
+		{
+			releaseCached( cached);
+			cached = nullptr;
+			--from;
+			iFree[ from][ BlockKey( key.first, key.second + classSize( from))] = nullptr;
+		}
+
+		return true;
+	}
+
+	void BufferPool::insert( uint sizeClass, BlockKey key, cl_mem cached)
+	{
+		while ( sizeClass + 1 < iFree.size())
+		{
+			const auto buddy = iFree[ sizeClass].find( BlockKey( key.first, key.second ^ classSize( sizeClass)));
+			if ( buddy == iFree[ sizeClass].end())
+			{
+				break;
+			}
+
+			releaseCached( buddy->second);
+			releaseCached( cached);
+			cached = nullptr;
+			key.second = std::min( key.second, buddy->first.second);
+			iFree[ sizeClass].erase( buddy);
+			++sizeClass;
+		}
+
+		iFree[ sizeClass][ key] = cached;
+	}
+
+	BufferAllocation BufferPool::allocate( const size_t size)
+	{
+		if ( !size)
+		{
+			return BufferAllocation();
+		}
+
+		if ( size > iMaxAllocation)
+		{
+			throw ApiException( "clCreateBuffer", CL_INVALID_BUFFER_SIZE);
+		}
+
+		std::lock_guard<std::mutex> lock( iMutex);
+		BufferAllocation allocation;
+		allocation.setSize( size);
+		cl_int error = CL_SUCCESS;
+		ulong committed = size;
+		if ( size > iSlabSize)
+		{
+			const auto buffer = clCreateBuffer( iContext, iAccess, size, nullptr, &error);
+			if ( error)
+			{
+				throw ApiException( "clCreateBuffer", error);
+			}
+
+			allocation.setBuffer( buffer);
+			iStatistics.setReserved( iStatistics.reserved() + size);
+			iStatistics.setSlabCreations( iStatistics.slabCreations() + 1);
+		}
+		else
+		{
+			const auto sizeClass = this->sizeClass( size);
+			BlockKey key;
+			cl_mem cached = nullptr;
+			if ( !take( sizeClass, key, cached))
+			{
+				addSlab();
+				take( sizeClass, key, cached);
+			}
+
+			if ( cached)
+			{
+				iStatistics.setCacheHits( iStatistics.cacheHits() + 1);
+			}
+			else
+			{
+				cl_buffer_region region;
+				region.origin = key.second;
+				region.size = classSize( sizeClass);
+				cached = clCreateSubBuffer( iSlabs[ key.first], iAccess, CL_BUFFER_CREATE_TYPE_REGION, &region, &error);
+				if ( error)
+				{
+					insert( sizeClass, key, nullptr);
+					throw ApiException( "clCreateSubBuffer", error);
+				}
+
+				iStatistics.setSubBufferCreations( iStatistics.subBufferCreations() + 1);
+			}
+
+			allocation.setBuffer( cached);
+			allocation.setSlab( key.first);
+			allocation.setOffset( key.second);
+			allocation.setSizeClass( sizeClass);
+			committed = classSize( sizeClass);
+		}
+
+		iStatistics.setAllocations( iStatistics.allocations() + 1);
+		iStatistics.setRequested( iStatistics.requested() + size);
+		iStatistics.setCommitted( iStatistics.committed() + committed);
+		iStatistics.setHighWater( std::max( iStatistics.highWater(), iStatistics.committed()));
+		return allocation;
+	}
+
+	void BufferPool::release( BufferAllocation& allocation)
+	{
+		if ( !allocation.isValid())
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock( iMutex);
+		ulong committed = allocation.size();
+		if ( allocation.slab() == BufferAllocation::dedicated)
+		{
+			clReleaseMemObject( allocation.buffer());
+			iStatistics.setReserved( iStatistics.reserved() - allocation.size());
+		}
+		else
+		{
+			// the sub-buffer stays with the block for the next allocation of the same class
+			insert( allocation.sizeClass(), BlockKey( allocation.slab(), allocation.offset()), allocation.buffer());
+			committed = classSize( allocation.sizeClass());
+		}
+
+		iStatistics.setRequested( iStatistics.requested() - allocation.size());
+		iStatistics.setCommitted( iStatistics.committed() - committed);
+		allocation = BufferAllocation();
+	}
+
+	StagingBuffer BufferPool::acquireStaging( const size_t size)
+	{
+		std::lock_guard<std::mutex> lock( iMutex);
+
+		// an idle buffer at most twice the size is good enough
+		const auto idle = iIdleStaging.lower_bound( size);
+		if ( idle != iIdleStaging.end() && idle->first / 2 <= size)
+		{
+			const auto staging = idle->second;
+			iIdleStaging.erase( idle);
+			return staging;
+		}
+
+		const auto rounded = size <= iSlabSize ? classSize( sizeClass( size)) : size;
+		cl_int error = CL_SUCCESS;
+		const auto buffer = clCreateBuffer( iContext, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, rounded, nullptr, &error);
+		if ( error)
+		{
+			throw ApiException( "clCreateBuffer", error);
+		}
+
+		const auto data = clEnqueueMapBuffer( iQueue, buffer, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, rounded, 0, nullptr, nullptr, &error);
+		if ( error)
+		{
+			clReleaseMemObject( buffer);
+			throw ApiException( "clEnqueueMapBuffer", error);
+		}
+
+		StagingBuffer staging;
+		staging.setBuffer( buffer);
+		staging.setData( data);
+		staging.setSize( rounded);
+		iStatistics.setStaging( iStatistics.staging() + rounded);
+		return staging;
+	}
+
+	void BufferPool::releaseStaging( StagingBuffer& staging)
+	{
+		if ( !staging.isValid())
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock( iMutex);
+		iIdleStaging.insert( StagingMap::value_type( staging.size(), staging));
+		staging = StagingBuffer();
+	}
+
+	void BufferPool::trim()
+	{
+		std::lock_guard<std::mutex> lock( iMutex);
+		for ( auto i = iFree.begin(); i != iFree.end(); ++i)
+		{
+			for ( auto j = i->begin(); j != i->end(); ++j)
+			{
+				releaseCached( j->second);
+				j->second = nullptr;
+			}
+		}
+
+		// blocks of the largest class are whole slabs
+		auto& empty = iFree.back();
+		for ( auto i = empty.begin(); i != empty.end(); ++i)
+		{
+			releaseCached( iSlabs[ i->first.first]);
+			iSlabs[ i->first.first] = nullptr;
+			iStatistics.setSlabCount( iStatistics.slabCount() - 1);
+			iStatistics.setReserved( iStatistics.reserved() - iSlabSize);
+		}
+
+		empty.clear();
+		for ( auto i = iIdleStaging.begin(); i != iIdleStaging.end(); ++i)
+		{
+			clEnqueueUnmapMemObject( iQueue, i->second.buffer(), i->second.data(), 0, nullptr, nullptr);
+			clReleaseMemObject( i->second.buffer());
+			iStatistics.setStaging( iStatistics.staging() - i->first);
+		}
+
+		iIdleStaging.clear();
+	}
+
+	BufferPoolStatistics BufferPool::statistics() const
+	{
+		std::lock_guard<std::mutex> lock( iMutex);
+		auto statistics = iStatistics;
+		ulong free = 0;
+		for ( uint c = 0; c < iFree.size(); ++c)
+		{
+			free += iFree[ c].size() * classSize( c);
+			if ( !iFree[ c].empty())
+			{
+				statistics.setLargestFreeBlock( classSize( c));
+			}
+		}
+
+		statistics.setFreeBytes( free);
+		return statistics;
+	}
+}
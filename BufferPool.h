@@ -0,0 +1,231 @@
+#pragma once
+#ifndef PCHDR
+	#include "OpenCLInfo.h"
+	#include <algorithm>
+	#include <map>
+	#include <mutex>
+	#include <ostream>
+	#include <vector>
+#endif
+
+namespace Info
+{
+	// a block of a slab, or a dedicated buffer for requests larger than a slab
+	class BufferAllocation
+	{
+	public:
+		static const uint dedicated = ~0u;
+
+		BufferAllocation():
+			iBuffer( nullptr),
+			iOffset( 0),
+			iSize( 0),
+			iSlab( dedicated),
+			iSizeClass( 0)
+		{}
+
+		bool isValid() const { return iBuffer != nullptr; }
+
+		// sub-buffer covering the whole block; owned by the pool
+		cl_mem buffer() const { return iBuffer; }
+		void setBuffer( const cl_mem value) { iBuffer = value; }
+
+		// within the slab; a multiple of the device base address alignment
+		size_t offset() const { return iOffset; }
+		void setOffset( const size_t value) { iOffset = value; }
+
+		// as requested; the block may be larger
+		size_t size() const { return iSize; }
+		void setSize( const size_t value) { iSize = value; }
+
+		uint slab() const { return iSlab; }
+		void setSlab( const uint value) { iSlab = value; }
+
+		uint sizeClass() const { return iSizeClass; }
+		void setSizeClass( const uint value) { iSizeClass = value; }
+
+	private:
+		cl_mem	iBuffer;
+		size_t	iOffset;
+		size_t	iSize;
+		uint	iSlab;
+		uint	iSizeClass;
+	};
+
+	// pinned host memory, mapped for the lifetime of the pool
+	class StagingBuffer
+	{
+	public:
+		StagingBuffer():
+			iBuffer( nullptr),
+			iData( nullptr),
+			iSize( 0)
+		{}
+
+		bool isValid() const { return iData != nullptr; }
+
+		cl_mem buffer() const { return iBuffer; }
+		void setBuffer( const cl_mem value) { iBuffer = value; }
+
+		// host pointer to pass to clEnqueueReadBuffer and clEnqueueWriteBuffer
+		void* data() const { return iData; }
+		void setData( void* const value) { iData = value; }
+
+		size_t size() const { return iSize; }
+		void setSize( const size_t value) { iSize = value; }
+
+	private:
+		cl_mem	iBuffer;
+		void*	iData;
+		size_t	iSize;
+	};
+
+	class BufferPoolStatistics
+	{
+	public:
+		BufferPoolStatistics():
+			iSlabSize( 0),
+			iSlabCount( 0),
+			iReserved( 0),
+			iRequested( 0),
+			iCommitted( 0),
+			iHighWater( 0),
+			iFreeBytes( 0),
+			iLargestFreeBlock( 0),
+			iStaging( 0),
+			iAllocations( 0),
+			iSlabCreations( 0),
+			iSubBufferCreations( 0),
+			iCacheHits( 0)
+		{}
+
+		ulong slabSize() const { return iSlabSize; }
+		void setSlabSize( const ulong value) { iSlabSize = value; }
+
+		uint slabCount() const { return iSlabCount; }
+		void setSlabCount( const uint value) { iSlabCount = value; }
+
+		// bytes held from the device: slabs and dedicated buffers
+		ulong reserved() const { return iReserved; }
+		void setReserved( const ulong value) { iReserved = value; }
+
+		// live bytes as requested, and rounded up to their blocks
+		ulong requested() const { return iRequested; }
+		void setRequested( const ulong value) { iRequested = value; }
+
+		ulong committed() const { return iCommitted; }
+		void setCommitted( const ulong value) { iCommitted = value; }
+
+		// peak of committed
+		ulong highWater() const { return iHighWater; }
+		void setHighWater( const ulong value) { iHighWater = value; }
+
+		// free bytes in slabs and the largest block among them
+		ulong freeBytes() const { return iFreeBytes; }
+		void setFreeBytes( const ulong value) { iFreeBytes = value; }
+
+		ulong largestFreeBlock() const { return iLargestFreeBlock; }
+		void setLargestFreeBlock( const ulong value) { iLargestFreeBlock = value; }
+
+		// pinned host bytes, in use or idle
+		ulong staging() const { return iStaging; }
+		void setStaging( const ulong value) { iStaging = value; }
+
+		ulong allocations() const { return iAllocations; }
+		void setAllocations( const ulong value) { iAllocations = value; }
+
+		// clCreateBuffer calls for slabs and dedicated buffers
+		ulong slabCreations() const { return iSlabCreations; }
+		void setSlabCreations( const ulong value) { iSlabCreations = value; }
+
+		ulong subBufferCreations() const { return iSubBufferCreations; }
+		void setSubBufferCreations( const ulong value) { iSubBufferCreations = value; }
+
+		// allocations that reused the sub-buffer of a released block
+		ulong cacheHits() const { return iCacheHits; }
+		void setCacheHits( const ulong value) { iCacheHits = value; }
+
+		// share of committed bytes lost to size class rounding
+		double internalFragmentation() const { return iCommitted ? 1.0 - static_cast<double>( iRequested) / iCommitted : 0.0; }
+
+		// share of free bytes unusable for an allocation of their total size, which is at most a slab
+		double externalFragmentation() const { return iFreeBytes ? 1.0 - static_cast<double>( iLargestFreeBlock) / std::min( iFreeBytes, iSlabSize) : 0.0; }
+
+	private:
+		ulong	iSlabSize;
+		uint	iSlabCount;
+		ulong	iReserved;
+		ulong	iRequested;
+		ulong	iCommitted;
+		ulong	iHighWater;
+		ulong	iFreeBytes;
+		ulong	iLargestFreeBlock;
+		ulong	iStaging;
+		ulong	iAllocations;
+		ulong	iSlabCreations;
+		ulong	iSubBufferCreations;
+		ulong	iCacheHits;
+	};
+
+	void write( std::ostream& stream, const BufferPoolStatistics& statistics);
+
+	// buddy sub-allocator over slabs of device memory; thread safe
+	class BufferPool
+	{
+	public:
+		// slabSize is capped at maxMemoryAllocSize and rounded down to a power of two multiple of the alignment;
+		// the queue maps the staging buffers; context and queue must outlive the pool
+		BufferPool( const cl_context context, const cl_command_queue queue, const Device& device, const size_t slabSize = 256 << 20, const cl_mem_flags access = CL_MEM_READ_WRITE);
+		~BufferPool();
+
+		size_t slabSize() const { return iSlabSize; }
+
+		// smallest block, the device base address alignment in bytes
+		size_t granularity() const { return iGranularity; }
+
+		// throws ApiException when the device is out of memory or size exceeds maxMemoryAllocSize
+		BufferAllocation allocate( const size_t size);
+		void release( BufferAllocation& allocation);
+
+		StagingBuffer acquireStaging( const size_t size);
+		void releaseStaging( StagingBuffer& staging);
+
+		// returns empty slabs, cached sub-buffers and idle staging buffers
+		void trim();
+
+		BufferPoolStatistics statistics() const;
+
+	private:
+		BufferPool( const BufferPool&);
+		BufferPool& operator=( const BufferPool&);
+
+		// slab and offset; the value is the sub-buffer kept from the last allocation of the block, if any
+		typedef std::pair<uint, size_t> BlockKey;
+		typedef std::map<BlockKey, cl_mem> FreeList;
+		typedef std::multimap<size_t, StagingBuffer> StagingMap;
+
+		uint sizeClass( const size_t size) const;
+		size_t classSize( const uint sizeClass) const { return iGranularity << sizeClass; }
+
+		// splits larger blocks as needed; false when every slab is exhausted
+		bool take( const uint sizeClass, BlockKey& key, cl_mem& cached);
+
+		// merges with free buddies up to a whole slab
+		void insert( uint sizeClass, BlockKey key, cl_mem cached);
+
+		uint addSlab();
+		static void releaseCached( const cl_mem cached);
+
+		mutable std::mutex		iMutex;
+		std::vector<cl_mem>		iSlabs;
+		std::vector<FreeList>	iFree;
+		StagingMap				iIdleStaging;
+		BufferPoolStatistics	iStatistics;
+		cl_context				iContext;
+		cl_command_queue		iQueue;
+		cl_mem_flags			iAccess;
+		size_t					iSlabSize;
+		size_t					iGranularity;
+		ulong					iMaxAllocation;
+	};
+}
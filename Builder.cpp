@@ -0,0 +1,209 @@
+#include "stdafx.h"
+#include "Builder.h"
+#include "ProgramCache.h"
+#include <chrono>
+#include <exception>
+
+namespace Info
+{
+	Builder::Builder( const cl_context context, ProgramCache* const cache, const size_t threadCount):
+		iCache( cache),
+		iContext( context),
+		iOutstanding( 0),
+		iRunning( 0),
+		iStopping( false)
+	{
+		size_t count = threadCount ? threadCount : std::thread::hardware_concurrency();
+		if ( !count)
+		{
+			count = 2;
+		}
+
+		for ( size_t i = 0; i < count; ++i)
+		{
+			iThreads.push_back( std::thread( &Builder::work, this));
+		}
+	}
+
+	Builder::~Builder()
+	{
+		{
+			std::lock_guard<std::mutex> lock( iMutex);
+			iStopping = true;
+		}
+
+		iWork.notify_all();
+		for ( auto i = iThreads.begin(); i != iThreads.end(); ++i)
+		{
+			i->join();
+		}
+	}
+
+	BuildFuture Builder::add( const BuildRequest& request)
+	{
+		Task task;
+		task.request = request;
+		task.promise = std::make_shared<std::promise<BuildResult> >();
+		task.future = task.promise->get_future().share();
+
+		{
+			std::lock_guard<std::mutex> lock( iMutex);
+			iPending.push_back( task);
+			++iOutstanding;
+		}
+
+		iWork.notify_one();
+		return task.future;
+	}
+
+	BuildFutureArray Builder::add( const std::string& source, const std::string& options, const std::vector<cl_device_id>& ids, const std::vector<const Device*>& devices)
+	{
+		BuildFutureArray futures;
+		for ( size_t i = 0; i < ids.size(); ++i)
+		{
+			BuildRequest request;
+			request.setId( ids[ i]);
+			request.setDevice( i < devices.size() ? devices[ i] : nullptr);
+			request.setSource( source);
+			request.setOptions( options);
+			futures.push_back( add( request));
+		}
+
+		return futures;
+	}
+
+	BuildFutureArray Builder::add( const std::vector<std::string>& sources, const std::string& options, const cl_device_id id, const Device* const device)
+	{
+		BuildFutureArray futures;
+		for ( auto i = sources.begin(); i != sources.end(); ++i)
+		{
+			BuildRequest request;
+			request.setId( id);
+			request.setDevice( device);
+			request.setSource( *i);
+			request.setOptions( options);
+			futures.push_back( add( request));
+		}
+
+		return futures;
+	}
+
+	bool Builder::next( BuildFuture& future)
+	{
+		std::unique_lock<std::mutex> lock( iMutex);
+		while ( iCompleted.empty() && iOutstanding)
+		{
+			iDone.wait( lock);
+		}
+
+		if ( iCompleted.empty())
+		{
+			return false;
+		}
+
+		future = iCompleted.front();
+		iCompleted.pop_front();
+		--iOutstanding;
+		return true;
+	}
+
+	void Builder::wait()
+	{
+		std::unique_lock<std::mutex> lock( iMutex);
+		while ( !iPending.empty() || iRunning)
+		{
+			iDone.wait( lock);
+		}
+	}
+
+	void Builder::work()
+	{
+		for ( ;;)
+		{
+			Task task;
+			{
+				std::unique_lock<std::mutex> lock( iMutex);
+				while ( iPending.empty() && !iStopping)
+				{
+					iWork.wait( lock);
+				}
+
+				if ( iPending.empty())
+				{
+					return;
+				}
+
+				task = iPending.front();
+				iPending.pop_front();
+				++iRunning;
+			}
+
+			// std::exception included, so nothing escapes the thread; get() rethrows it
+			try
+			{
+				task.promise->set_value( run( task.request));
+			}
+			catch( ...)
+			{
+				task.promise->set_exception( std::current_exception());
+			}
+
+			{
+				std::lock_guard<std::mutex> lock( iMutex);
+				iCompleted.push_back( task.future);
+				--iRunning;
+			}
+
+			iDone.notify_all();
+		}
+	}
+
+	BuildResult Builder::run( const BuildRequest& request) const
+	{
+		BuildResult result;
+		result.setId( request.id());
+
+		const auto start = std::chrono::steady_clock::now();
+		if ( iCache && request.device())
+		{
+			std::string log;
+			try
+			{
+				bool hit = false;
+				result.setProgram( iCache->build( iContext, request.id(), *request.device(), request.source(), request.options(), &hit, &log));
+				result.setCacheHit( hit);
+			}
+			catch( ApiException& ex)
+			{
+				result.setError( ex.error());
+			}
+
+			result.setLog( log);
+		}
+		else
+		{
+			cl_int error = CL_SUCCESS;
+			const char* text = request.source().c_str();
+			const size_t textSize = request.source().size();
+			auto program = clCreateProgramWithSource( iContext, 1, &text, &textSize, &error);
+			if ( !error)
+			{
+				const auto id = request.id();
+				error = clBuildProgram( program, 1, &id, request.options().c_str(), nullptr, nullptr);
+				result.setLog( buildLog( program, id));
+			}
+
+			if ( error && program)
+			{
+				clReleaseProgram( program);
+				program = nullptr;
+			}
+
+			result.setProgram( program);
+			result.setError( error);
+		}
+
+		result.setMilliseconds( std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start).count());
+		return result;
+	}
+}
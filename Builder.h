@@ -0,0 +1,138 @@
+#pragma once
+#ifndef PCHDR
+	#include "OpenCLInfo.h"
+	#include <condition_variable>
+	#include <deque>
+	#include <future>
+	#include <memory>
+	#include <mutex>
+	#include <string>
+	#include <thread>
+	#include <vector>
+#endif
+
+namespace Info
+{
+	class ProgramCache;
+
+	class BuildRequest
+	{
+	public:
+		BuildRequest():
+			iId( nullptr),
+			iDevice( nullptr)
+		{}
+
+		cl_device_id id() const { return iId; }
+		void setId( const cl_device_id value) { iId = value; }
+
+		// required when the builder uses a program cache
+		const Device* device() const { return iDevice; }
+		void setDevice( const Device* const item) { iDevice = item; }
+
+		const std::string& source() const { return iSource; }
+		void setSource( const std::string& item) { iSource = item; }
+
+		const std::string& options() const { return iOptions; }
+		void setOptions( const std::string& item) { iOptions = item; }
+
+	private:
+		std::string		iSource;
+		std::string		iOptions;
+		cl_device_id	iId;
+		const Device*	iDevice;
+	};
+
+	class BuildResult
+	{
+	public:
+		BuildResult():
+			iProgram( nullptr),
+			iId( nullptr),
+			iMilliseconds( 0.0),
+			iError( CL_SUCCESS),
+			iCacheHit( false)
+		{}
+
+		// owned by the caller; null when the build failed
+		cl_program program() const { return iProgram; }
+		void setProgram( const cl_program value) { iProgram = value; }
+
+		cl_device_id id() const { return iId; }
+		void setId( const cl_device_id value) { iId = value; }
+
+		const std::string& log() const { return iLog; }
+		void setLog( const std::string& item) { iLog = item; }
+
+		double milliseconds() const { return iMilliseconds; }
+		void setMilliseconds( const double value) { iMilliseconds = value; }
+
+		cl_int error() const { return iError; }
+		void setError( const cl_int value) { iError = value; }
+
+		bool isCacheHit() const { return iCacheHit; }
+		void setCacheHit( const bool value) { iCacheHit = value; }
+
+	private:
+		std::string		iLog;
+		cl_program		iProgram;
+		cl_device_id	iId;
+		double			iMilliseconds;
+		cl_int			iError;
+		bool			iCacheHit;
+	};
+
+	// get() rethrows what the build threw other than an ApiException, which lands in BuildResult::error
+	typedef std::shared_future<BuildResult> BuildFuture;
+	typedef std::vector<BuildFuture> BuildFutureArray;
+
+	class Builder
+	{
+	public:
+		// threadCount 0 uses one thread per hardware thread
+		explicit Builder( const cl_context context, ProgramCache* const cache = nullptr, const size_t threadCount = 0);
+		~Builder();
+
+		BuildFuture add( const BuildRequest& request);
+
+		// one program for many devices
+		BuildFutureArray add( const std::string& source, const std::string& options, const std::vector<cl_device_id>& ids, const std::vector<const Device*>& devices);
+
+		// many programs for one device
+		BuildFutureArray add( const std::vector<std::string>& sources, const std::string& options, const cl_device_id id, const Device* const device);
+
+		// blocks until the next build finishes, in completion order; false once every added build was returned
+		bool next( BuildFuture& future);
+
+		void wait();
+
+	private:
+		Builder( const Builder&);
+		Builder& operator=( const Builder&);
+
+		typedef std::shared_ptr<std::promise<BuildResult> > Promise;
+
+		class Task
+		{
+		public:
+			BuildRequest	request;
+			Promise			promise;
+			BuildFuture		future;
+		};
+
+		void work();
+		BuildResult run( const BuildRequest& request) const;
+
+		std::vector<std::thread>	iThreads;
+		std::deque<Task>			iPending;
+		std::deque<BuildFuture>		iCompleted;
+		std::mutex					iMutex;
+		std::condition_variable		iWork;
+		std::condition_variable		iDone;
+		ProgramCache*				iCache;
+		cl_context					iContext;
+		size_t						iOutstanding;
+		size_t						iRunning;
+		bool						iStopping;
+	};
+}
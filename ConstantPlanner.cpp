@@ -0,0 +1,260 @@
+#include "stdafx.h"
+#include "ConstantPlanner.h"
+#include "ProgramCache.h"
+#include <algorithm>
+#include <sstream>
+
+namespace Info
+{
+	namespace
+	{
+		std::string trim( const std::string& text)
+		{
+			const auto first = text.find_first_not_of( " \t");
+			const auto last = text.find_last_not_of( " \t");
+			return first == std::string::npos ? std::string() : text.substr( first, last - first + 1);
+		}
+
+		// accepts a K or M suffix (binary multiples)
+		bool parseSize( ulong& value, const std::string& text)
+		{
+			char* end = nullptr;
+			value = strtoull( text.c_str(), &end, 10);
+			if ( end == text.c_str())
+			{
+				return false;
+			}
+
+			switch ( *end)
+			{
+				case 'K': case 'k': value <<= 10; ++end; break;
+				case 'M': case 'm': value <<= 20; ++end; break;
+			}
+
+			return *end == 0;
+		}
+
+		// OpenCL C 2.0 has program scope __global variables, 3.0 only as an optional feature
+		bool programScopeGlobal( const Device& device)
+		{
+			const auto& features = device.openClCFeatures();
+			if ( std::find( features.begin(), features.end(), "__opencl_c_program_scope_global_variables") != features.end())
+			{
+				return true;
+			}
+
+			const auto& version = device.openClVersion();
+			const auto start = version.find( "OpenCL C ");
+			return start != std::string::npos && strtoul( version.c_str() + start + 9, nullptr, 10) == 2;
+		}
+	}
+
+	bool parseCandidates( ConstantCandidateArray& candidates, const std::string& text)
+	{
+		candidates.clear();
+		size_t start = 0;
+		while ( start < text.size())
+		{
+			auto stop = text.find( ',', start);
+			stop = stop == std::string::npos ? text.size() : stop;
+			const auto term = text.substr( start, stop - start);
+			start = stop + 1;
+
+			const auto first = term.find( ':');
+			if ( first == std::string::npos)
+			{
+				return false;
+			}
+
+			const auto second = term.find( ':', first + 1);
+			ConstantCandidate candidate;
+			candidate.setName( trim( term.substr( 0, first)));
+
+			ulong size = 0;
+			if ( candidate.name().empty() || !parseSize( size, trim( term.substr( first + 1, second == std::string::npos ? std::string::npos : second - first - 1))))
+			{
+				return false;
+			}
+
+			candidate.setSize( size);
+			if ( second != std::string::npos)
+			{
+				const auto weight = trim( term.substr( second + 1));
+				char* end = nullptr;
+				candidate.setWeight( strtod( weight.c_str(), &end));
+				if ( end == weight.c_str() || *end || candidate.weight() < 0.0)
+				{
+					return false;
+				}
+			}
+
+			candidates.push_back( candidate);
+		}
+
+		return !candidates.empty();
+	}
+
+	ConstantPlanner::ConstantPlanner( const Device& device):
+		iMaxConstantBufferSize( device.maxConstantBufferSize()),
+		iMaxParameterSize( device.maxParameterSize()),
+		iReserve( 0),
+		iPadding( 16),
+		iResolution( device.profilingTimerResolution()),
+		iMaxConstantArgs( device.maxConstantArgs()),
+		iPointerSize( device.addressBits() ? device.addressBits() / 8 : static_cast<uint>( sizeof(void*))),
+		iProgramScopeGlobal( programScopeGlobal( device))
+	{}
+
+	ConstantPlan ConstantPlanner::plan( const ConstantCandidateArray& candidates, const ulong argumentBytes) const
+	{
+		ConstantPlan result;
+		std::vector<Placement> placements( candidates.size(), plGlobal);
+
+		// a table is passed as a pointer wherever it lives
+		ulong parameterBytes = argumentBytes;
+		for ( auto i = candidates.begin(); i != candidates.end(); ++i)
+		{
+			parameterBytes += i->use() == cuArgument ? iPointerSize : 0;
+		}
+
+		result.setParameterBytes( parameterBytes);
+		result.setParametersFit( parameterBytes <= iMaxParameterSize);
+
+		std::vector<size_t> order( candidates.size());
+		for ( size_t i = 0; i < order.size(); ++i)
+		{
+			order[ i] = i;
+		}
+
+		std::stable_sort( order.begin(), order.end(), [&]( const size_t a, const size_t b)
+		{
+			return candidates[ a].weight() * std::max<ulong>( candidates[ b].size(), 1) > candidates[ b].weight() * std::max<ulong>( candidates[ a].size(), 1);
+		});
+
+		const auto budget = iMaxConstantBufferSize > iReserve ? iMaxConstantBufferSize - iReserve : 0;
+		ulong bytes = 0;
+		uint args = 0;
+		const auto padded = [&]( const ConstantCandidate& candidate) { return iPadding ? ( candidate.size() + iPadding - 1) / iPadding * iPadding : candidate.size(); };
+
+		// program scope tables have nowhere else to go without program scope __global
+		if ( !iProgramScopeGlobal)
+		{
+			for ( size_t i = 0; i < candidates.size(); ++i)
+			{
+				if ( candidates[ i].use() == cuProgram)
+				{
+					placements[ i] = plConstant;
+					bytes += padded( candidates[ i]);
+				}
+			}
+		}
+
+		result.setConstantFits( bytes <= budget);
+		for ( auto i = order.begin(); i != order.end(); ++i)
+		{
+			const auto& candidate = candidates[ *i];
+			const auto arg = candidate.use() == cuArgument ? 1u : 0u;
+			if ( placements[ *i] == plGlobal && candidate.size() && bytes + padded( candidate) <= budget && args + arg <= iMaxConstantArgs)
+			{
+				placements[ *i] = plConstant;
+				bytes += padded( candidate);
+				args += arg;
+			}
+		}
+
+		result.setPlacements( placements);
+		result.setConstantBytes( bytes);
+		result.setConstantArgs( args);
+		return result;
+	}
+
+	std::string ConstantPlanner::defines( const ConstantCandidateArray& candidates, const ConstantPlan& plan)
+	{
+		std::ostringstream stream;
+		for ( size_t i = 0; i < candidates.size(); ++i)
+		{
+			const auto placement = i < plan.placements().size() ? plan.placements()[ i] : plGlobal;
+			stream << ( i ? " " : "") << "-D " << candidates[ i].name() << "_SPACE=" << ( placement == plConstant ? "__constant" : "__global");
+		}
+
+		return stream.str();
+	}
+
+	std::string ConstantPlanner::defines( const ConstantCandidateArray& candidates, const Placement placement) const
+	{
+		std::vector<Placement> placements( candidates.size(), placement);
+		for ( size_t i = 0; i < candidates.size() && !iProgramScopeGlobal; ++i)
+		{
+			placements[ i] = candidates[ i].use() == cuProgram ? plConstant : placement;
+		}
+
+		ConstantPlan plan;
+		plan.setPlacements( placements);
+		return defines( candidates, plan);
+	}
+
+	cl_program ConstantPlanner::build( const cl_context context, const cl_device_id id, const std::string& source, const std::string& options) const
+	{
+		cl_int error = CL_SUCCESS;
+		const char* text = source.c_str();
+		const size_t textSize = source.size();
+		auto program = clCreateProgramWithSource( context, 1, &text, &textSize, &error);
+		if ( error)
+		{
+			throw ApiException( "clCreateProgramWithSource", error);
+		}
+
+		error = clBuildProgram( program, 1, &id, options.c_str(), nullptr, nullptr);
+		if ( error)
+		{
+			std::cerr << buildLog( program, id) << '\n';
+			clReleaseProgram( program);
+			throw ApiException( "clBuildProgram", error);
+		}
+
+		return program;
+	}
+
+	PlacementComparison ConstantPlanner::compare( const cl_context context, const cl_device_id id, const std::string& source, const std::string& options, const ConstantCandidateArray& candidates, const ConstantPlan& plan, const Launch& launch) const
+	{
+		Benchmark benchmark( iResolution);
+		benchmark.setSettings( iSettings);
+
+		const auto measure = [&]( const std::string& defines) -> BenchmarkResult
+		{
+			const auto program = build( context, id, source, options + " " + defines);
+			const auto measured = benchmark.run( [&]() -> cl_event { return launch( program); });
+			clReleaseProgram( program);
+			return measured;
+		};
+
+		PlacementComparison result;
+
+		// a __constant overflow usually fails the build; the baseline is still worth measuring then
+		try
+		{
+			result.setPlanned( measure( defines( candidates, plan)));
+		}
+		catch ( ApiException& ex)
+		{
+			if ( strcmp( ex.function(), "clBuildProgram"))
+			{
+				throw;
+			}
+		}
+
+		result.setGlobal( measure( defines( candidates, plGlobal)));
+		return result;
+	}
+
+	void write( std::ostream& stream, const ConstantCandidateArray& candidates, const ConstantPlan& plan)
+	{
+		for ( size_t i = 0; i < candidates.size() && i < plan.placements().size(); ++i)
+		{
+			stream << candidates[ i].name() << ": " << candidates[ i].size() << " bytes -> " << ( plan.placements()[ i] == plConstant ? "__constant" : "__global") << '\n';
+		}
+
+		stream << plan.constantBytes() << " constant bytes in " << plan.constantArgs() << " arguments, " << plan.parameterBytes() << " parameter bytes" <<
+			( plan.parametersFit() ? "" : " (exceeds maxParameterSize)") << ( plan.constantFits() ? "" : " (program scope tables exceed maxConstantBufferSize)") << '\n';
+	}
+}
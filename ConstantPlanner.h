@@ -0,0 +1,168 @@
+#pragma once
+#ifndef PCHDR
+	#include "Benchmark.h"
+	#include "OpenCLInfo.h"
+	#include <functional>
+	#include <ostream>
+	#include <string>
+	#include <vector>
+#endif
+
+namespace Info
+{
+	enum ConstantUse
+	{
+		cuArgument,		// pointer kernel argument; counts against maxConstantArgs
+		cuProgram		// program scope array; only its bytes count, and __global needs OpenCL C 2.0 or the 3.0 feature
+	};
+
+	// a lookup table that a kernel reads through NAME_SPACE, defined to __constant or __global
+	class ConstantCandidate
+	{
+	public:
+		ConstantCandidate():
+			iSize( 0),
+			iWeight( 1.0),
+			iUse( cuArgument)
+		{}
+
+		const std::string& name() const { return iName; }
+		void setName( const std::string& item) { iName = item; }
+
+		ulong size() const { return iSize; }
+		void setSize( const ulong value) { iSize = value; }
+
+		// relative number of reads, so frequently read small tables are placed first
+		double weight() const { return iWeight; }
+		void setWeight( const double value) { iWeight = value; }
+
+		ConstantUse use() const { return iUse; }
+		void setUse( const ConstantUse value) { iUse = value; }
+
+	private:
+		std::string	iName;
+		ulong		iSize;
+		double		iWeight;
+		ConstantUse	iUse;
+	};
+
+	typedef std::vector<ConstantCandidate> ConstantCandidateArray;
+
+	// name:size[:weight], comma separated; sizes in bytes
+	bool parseCandidates( ConstantCandidateArray& candidates, const std::string& text);
+
+	enum Placement
+	{
+		plConstant,
+		plGlobal
+	};
+
+	class ConstantPlan
+	{
+	public:
+		ConstantPlan():
+			iConstantBytes( 0),
+			iParameterBytes( 0),
+			iConstantArgs( 0),
+			iParametersFit( false),
+			iConstantFits( true)
+		{}
+
+		// false when the kernel cannot work whatever the placement
+		bool isValid() const { return iParametersFit && iConstantFits; }
+
+		// one per candidate, in the order given
+		const std::vector<Placement>& placements() const { return iPlacements; }
+		void setPlacements( const std::vector<Placement>& item) { iPlacements = item; }
+
+		// padded bytes and arguments used in __constant
+		ulong constantBytes() const { return iConstantBytes; }
+		void setConstantBytes( const ulong value) { iConstantBytes = value; }
+
+		uint constantArgs() const { return iConstantArgs; }
+		void setConstantArgs( const uint value) { iConstantArgs = value; }
+
+		ulong parameterBytes() const { return iParameterBytes; }
+		void setParameterBytes( const ulong value) { iParameterBytes = value; }
+
+		bool parametersFit() const { return iParametersFit; }
+		void setParametersFit( const bool value) { iParametersFit = value; }
+
+		// false when program scope tables had to stay in __constant beyond its size, on devices without program scope __global
+		bool constantFits() const { return iConstantFits; }
+		void setConstantFits( const bool value) { iConstantFits = value; }
+
+	private:
+		std::vector<Placement>	iPlacements;
+		ulong					iConstantBytes;
+		ulong					iParameterBytes;
+		uint					iConstantArgs;
+		bool					iParametersFit;
+		bool					iConstantFits;
+	};
+
+	class PlacementComparison
+	{
+	public:
+		const BenchmarkResult& planned() const { return iPlanned; }
+		void setPlanned( const BenchmarkResult& item) { iPlanned = item; }
+
+		// every candidate in __global
+		const BenchmarkResult& global() const { return iGlobal; }
+		void setGlobal( const BenchmarkResult& item) { iGlobal = item; }
+
+		// an invalid planned result means the build or the launch failed, which is how __constant overflow shows
+		bool plannedFaster() const { return iPlanned.isValid() && ( !iGlobal.isValid() || iPlanned.median() < iGlobal.median()); }
+
+	private:
+		BenchmarkResult	iPlanned;
+		BenchmarkResult	iGlobal;
+	};
+
+	class ConstantPlanner
+	{
+	public:
+		// creates the kernel from the program, sets its arguments and enqueues it; nullptr on failure
+		typedef std::function<cl_event ( const cl_program program)> Launch;
+
+		explicit ConstantPlanner( const Device& device);
+
+		// __constant bytes left to the compiler for literals and the like
+		ulong reserve() const { return iReserve; }
+		void setReserve( const ulong value) { iReserve = value; }
+
+		// each table is padded to this many bytes
+		ulong padding() const { return iPadding; }
+		void setPadding( const ulong value) { iPadding = value; }
+
+		const BenchmarkSettings& settings() const { return iSettings; }
+		void setSettings( const BenchmarkSettings& item) { iSettings = item; }
+
+		// greedy by weight per byte; argumentBytes is the size of every other kernel argument
+		ConstantPlan plan( const ConstantCandidateArray& candidates, const ulong argumentBytes = 0) const;
+
+		// -D NAME_SPACE=__constant or __global for each candidate
+		static std::string defines( const ConstantCandidateArray& candidates, const ConstantPlan& plan);
+
+		// every candidate in placement, except program scope tables stay in __constant on devices without program scope __global
+		std::string defines( const ConstantCandidateArray& candidates, const Placement placement) const;
+
+		// builds source with the planned and with the all-__global defines appended to options and times launch on each
+		PlacementComparison compare( const cl_context context, const cl_device_id id, const std::string& source, const std::string& options, const ConstantCandidateArray& candidates, const ConstantPlan& plan, const Launch& launch) const;
+
+	private:
+		cl_program build( const cl_context context, const cl_device_id id, const std::string& source, const std::string& options) const;
+
+		BenchmarkSettings	iSettings;
+		ulong				iMaxConstantBufferSize;
+		ulong				iMaxParameterSize;
+		ulong				iReserve;
+		ulong				iPadding;
+		size_t				iResolution;
+		uint				iMaxConstantArgs;
+		uint				iPointerSize;
+		bool				iProgramScopeGlobal;
+	};
+
+	void write( std::ostream& stream, const ConstantCandidateArray& candidates, const ConstantPlan& plan);
+}
@@ -0,0 +1,142 @@
+#include "stdafx.h"
+#include "DeviceProbes.h"
+#include "ProgramCache.h"
+#include <algorithm>
+
+namespace Info
+{
+	namespace
+	{
+		const char* const kernelSource =
+			"__kernel void copy( __global const float4* a, __global float4* b) { const size_t i = get_global_id( 0); b[ i] = a[ i]; }\n"
+			"__kernel void empty() {}\n";
+
+		// a float4 element of the copy kernel
+		const size_t elementSize = 4 * sizeof(float);
+
+		void check( const cl_int error, const char* const function)
+		{
+			if ( error)
+			{
+				throw ApiException( function, error);
+			}
+		}
+	}
+
+	void DeviceProbes::measure( MeasurementArray& measurements, const cl_context context, const cl_device_id id, const Device& device, const std::string& key) const
+	{
+		cl_int error = CL_SUCCESS;
+		const auto queue = clCreateCommandQueue( context, id, CL_QUEUE_PROFILING_ENABLE, &error);
+		check( error, "clCreateCommandQueue");
+
+		cl_program program = nullptr;
+		cl_mem buffers[ 2] = {};
+		cl_kernel kernels[ 2] = {};
+		try
+		{
+			const char* source = kernelSource;
+			const size_t sourceSize = strlen( source);
+			program = clCreateProgramWithSource( context, 1, &source, &sourceSize, &error);
+			check( error, "clCreateProgramWithSource");
+
+			error = clBuildProgram( program, 1, &id, "", nullptr, nullptr);
+			if ( error)
+			{
+				std::cerr << buildLog( program, id) << '\n';
+				check( error, "clBuildProgram");
+			}
+
+			kernels[ 0] = clCreateKernel( program, "copy", &error);
+			check( error, "clCreateKernel");
+			kernels[ 1] = clCreateKernel( program, "empty", &error);
+			check( error, "clCreateKernel");
+
+			const auto limit = device.maxMemoryAllocSize() ? static_cast<size_t>( std::min<ulong>( iBytes, device.maxMemoryAllocSize())) : iBytes;
+			const auto size = limit / elementSize * elementSize;
+			const std::vector<char> data( size);
+			for ( uint b = 0; b < 2; ++b)
+			{
+				buffers[ b] = clCreateBuffer( context, CL_MEM_READ_WRITE, size, nullptr, &error);
+				check( error, "clCreateBuffer");
+
+				// first touch and migration paid here rather than in the timings
+				check( clEnqueueWriteBuffer( queue, buffers[ b], CL_TRUE, 0, size, &data[ 0], 0, nullptr, nullptr), "clEnqueueWriteBuffer");
+			}
+
+			check( clSetKernelArg( kernels[ 0], 0, sizeof(cl_mem), &buffers[ 0]) | clSetKernelArg( kernels[ 0], 1, sizeof(cl_mem), &buffers[ 1]), "clSetKernelArg");
+
+			Benchmark benchmark( device.profilingTimerResolution());
+			benchmark.setSettings( iSettings);
+
+			{
+				const size_t global = size / elementSize;
+				const auto result = benchmark.run( [&]() -> cl_event
+				{
+					cl_event event = nullptr;
+					return clEnqueueNDRangeKernel( queue, kernels[ 0], 1, nullptr, &global, nullptr, 0, nullptr, &event) ? nullptr : event;
+				});
+
+				// bytes per nanosecond is GB/s
+				std::vector<double> samples;
+				for ( auto i = result.samples().begin(); i != result.samples().end(); ++i)
+				{
+					samples.push_back( 2.0 * size / *i);
+				}
+
+				Measurement item;
+				item.setDevice( key);
+				item.setName( "copyBandwidth");
+				item.setHigherIsBetter( true);
+				item.setSamples( samples);
+				measurements.push_back( item);
+			}
+
+			{
+				const size_t global = 1;
+				const auto result = benchmark.runHost( [&]() -> bool
+				{
+					return !clEnqueueNDRangeKernel( queue, kernels[ 1], 1, nullptr, &global, nullptr, 0, nullptr, nullptr) && !clFinish( queue);
+				});
+
+				Measurement item;
+				item.setDevice( key);
+				item.setName( "launchLatency");
+				item.setHigherIsBetter( false);
+				item.setSamples( result.samples());
+				measurements.push_back( item);
+			}
+		}
+		catch ( ...)
+		{
+			for ( uint k = 0; k < 2; ++k)
+			{
+				if ( kernels[ k])
+				{
+					clReleaseKernel( kernels[ k]);
+				}
+
+				if ( buffers[ k])
+				{
+					clReleaseMemObject( buffers[ k]);
+				}
+			}
+
+			if ( program)
+			{
+				clReleaseProgram( program);
+			}
+
+			clReleaseCommandQueue( queue);
+			throw;
+		}
+
+		for ( uint k = 0; k < 2; ++k)
+		{
+			clReleaseKernel( kernels[ k]);
+			clReleaseMemObject( buffers[ k]);
+		}
+
+		clReleaseProgram( program);
+		clReleaseCommandQueue( queue);
+	}
+}
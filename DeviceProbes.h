@@ -0,0 +1,34 @@
+#pragma once
+#ifndef PCHDR
+	#include "Benchmark.h"
+	#include "OpenCLInfo.h"
+	#include "SnapshotDiff.h"
+	#include <string>
+#endif
+
+namespace Info
+{
+	// the measurements the snapshot diff compares next to the capabilities
+	class DeviceProbes
+	{
+	public:
+		DeviceProbes():
+			iBytes( 64 << 20)
+		{}
+
+		// size of each copy buffer; capped at maxMemoryAllocSize
+		size_t bytes() const { return iBytes; }
+		void setBytes( const size_t value) { iBytes = value; }
+
+		const BenchmarkSettings& settings() const { return iSettings; }
+		void setSettings( const BenchmarkSettings& item) { iSettings = item; }
+
+		// appends copyBandwidth (GB/s, read plus write) and launchLatency (ns from enqueue to clFinish of an
+		// empty kernel) for the device, named key; throws ApiException
+		void measure( MeasurementArray& measurements, const cl_context context, const cl_device_id id, const Device& device, const std::string& key) const;
+
+	private:
+		BenchmarkSettings	iSettings;
+		size_t				iBytes;
+	};
+}
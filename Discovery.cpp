@@ -0,0 +1,250 @@
+#include "stdafx.h"
+#include "Discovery.h"
+#include "Fingerprint.h"
+
+#ifndef CL_DEVICE_PCI_BUS_INFO_KHR
+	#define CL_DEVICE_PCI_BUS_INFO_KHR 0x410F
+#endif
+
+#ifndef CL_DEVICE_PCI_BUS_ID_NV
+	#define CL_DEVICE_PCI_BUS_ID_NV 0x4008
+	#define CL_DEVICE_PCI_SLOT_ID_NV 0x4009
+	#define CL_DEVICE_PCI_DOMAIN_ID_NV 0x400A
+#endif
+
+#ifndef CL_DEVICE_TOPOLOGY_AMD
+	#define CL_DEVICE_TOPOLOGY_AMD 0x4037
+	#define CL_DEVICE_TOPOLOGY_TYPE_PCIE_AMD 1
+#endif
+
+namespace Info
+{
+	namespace
+	{
+		const uint vendorNvidia = 0x10DE;
+		const uint vendorAmd = 0x1002;
+
+		struct PciBusInfoKhr
+		{
+			cl_uint domain;
+			cl_uint bus;
+			cl_uint device;
+			cl_uint function;
+		};
+
+		union TopologyAmd
+		{
+			struct
+			{
+				cl_uint type;
+				cl_uint data[ 5];
+			} raw;
+
+			struct
+			{
+				cl_uint type;
+				char unused[ 17];
+				char bus;
+				char device;
+				char function;
+			} pcie;
+		};
+	}
+
+	uint flags( const DeviceInstance& instance)
+	{
+		uint result = instance.isAvailable() ? dfAvailable : 0;
+		result |= instance.pciLocation().isValid() ? dfPciLocation : 0;
+		if ( !instance.record())
+		{
+			return result;
+		}
+
+		const auto& device = *instance.record();
+		result |= device.isCompilerAvailable() ? dfCompilerAvailable : 0;
+		result |= device.isLinkerAvailable() ? dfLinkerAvailable : 0;
+		result |= device.isLittleEndian() ? dfLittleEndian : 0;
+		result |= device.hasHostUnifiedMemory() ? dfHostUnifiedMemory : 0;
+		result |= device.hasErrorCorrectionSupport() ? dfErrorCorrectionSupport : 0;
+		result |= device.image() ? dfImageSupport : 0;
+		result |= device.preferredInteropUserSync() ? dfPreferredInteropUserSync : 0;
+		for ( auto i = device.type().begin(); i != device.type().end(); ++i)
+		{
+			result |= *i == dtCPU ? dfCPU : *i == dtGPU ? dfGPU : *i == dtAccelerator ? dfAccelerator : 0;
+		}
+
+		return result;
+	}
+
+	std::string quickFingerprint( const cl_device_id id)
+	{
+		Hash hash;
+
+		char buffer[ 256];
+		readString( buffer, sizeof(buffer), id, CL_DEVICE_NAME);
+		hash.add( std::string( buffer));
+
+		readString( buffer, sizeof(buffer), id, CL_DRIVER_VERSION);
+		hash.add( std::string( buffer));
+
+		hash.add( read<cl_uint>( id, CL_DEVICE_VENDOR_ID));
+		hash.add( read<cl_ulong>( id, CL_DEVICE_GLOBAL_MEM_SIZE));
+		return hash.text();
+	}
+
+	PciLocation readPciLocation( const cl_device_id id, const uint vendorId)
+	{
+		PciLocation location;
+		{
+			PciBusInfoKhr info;
+			if ( getDeviceInfo( id, CL_DEVICE_PCI_BUS_INFO_KHR, sizeof(info), &info, nullptr) == CL_SUCCESS)
+			{
+				location.setDomain( info.domain);
+				location.setBus( info.bus);
+				location.setDevice( info.device);
+				location.setFunction( info.function);
+				location.setValid( true);
+				return location;
+			}
+		}
+
+		if ( vendorId == vendorNvidia)
+		{
+			cl_uint bus = 0, slot = 0, domain = 0;
+			if ( getDeviceInfo( id, CL_DEVICE_PCI_BUS_ID_NV, sizeof(bus), &bus, nullptr) == CL_SUCCESS &&
+				getDeviceInfo( id, CL_DEVICE_PCI_SLOT_ID_NV, sizeof(slot), &slot, nullptr) == CL_SUCCESS)
+			{
+				getDeviceInfo( id, CL_DEVICE_PCI_DOMAIN_ID_NV, sizeof(domain), &domain, nullptr);
+				location.setDomain( domain);
+				location.setBus( bus);
+				location.setDevice( slot >> 3);
+				location.setFunction( slot & 7);
+				location.setValid( true);
+			}
+		}
+		else if ( vendorId == vendorAmd)
+		{
+			TopologyAmd topology;
+			if ( getDeviceInfo( id, CL_DEVICE_TOPOLOGY_AMD, sizeof(topology), &topology, nullptr) == CL_SUCCESS &&
+				topology.raw.type == CL_DEVICE_TOPOLOGY_TYPE_PCIE_AMD)
+			{
+				location.setBus( static_cast<byte>( topology.pcie.bus));
+				location.setDevice( static_cast<byte>( topology.pcie.device));
+				location.setFunction( static_cast<byte>( topology.pcie.function));
+				location.setValid( true);
+			}
+		}
+
+		return location;
+	}
+
+	void read( DeviceInstance& item, const cl_device_id id, const DiscoveryMode mode, DeviceRecordMap& known)
+	{
+		item.setId( id);
+
+		std::string key;
+		if ( mode == dmDeduplicate)
+		{
+			key = quickFingerprint( id);
+			auto i = known.find( key);
+			if ( i != known.end())
+			{
+				item.setRecord( i->second);
+				item.setShared( true);
+				item.setAvailable( read<cl_bool>( id, CL_DEVICE_AVAILABLE) != 0);
+				item.setPciLocation( readPciLocation( id, i->second->vendorId()));
+				return;
+			}
+		}
+
+		auto device = std::make_shared<Device>();
+		read( *device, id);
+		item.setRecord( device);
+		item.setShared( false);
+		item.setAvailable( device->isAvailable());
+		item.setPciLocation( readPciLocation( id, device->vendorId()));
+
+		if ( mode == dmDeduplicate)
+		{
+			known[ key] = device;
+		}
+	}
+
+	cl_int discover( DeviceInstanceArray& devices, const cl_platform_id platform, const cl_device_type type, const DiscoveryMode mode, DeviceRecordMap& known)
+	{
+		devices.clear();
+
+		cl_uint count = 0;
+		if ( clGetDeviceIDs( platform, type, 0, nullptr, &count) || !count)
+		{
+			return CL_SUCCESS;
+		}
+
+		std::vector<cl_device_id> ids( count);
+		if ( clGetDeviceIDs( platform, type, count, &ids[ 0], nullptr))
+		{
+			return CL_SUCCESS;
+		}
+
+		cl_int failure = CL_SUCCESS;
+		for ( cl_uint i = 0; i < count; ++i)
+		{
+			DeviceInstance instance;
+			try
+			{
+				read( instance, ids[ i], mode, known);
+			}
+			catch( Exception& ex)
+			{
+				failure = failure ? failure : ex.error();
+				continue;
+			}
+
+			devices.push_back( instance);
+		}
+
+		return failure;
+	}
+
+	cl_int discover( PlatformRecordArray& platforms, const cl_device_type type, const DiscoveryMode mode)
+	{
+		platforms.clear();
+
+		cl_uint count = 0;
+		auto error = clGetPlatformIDs( 0, nullptr, &count);
+		if ( error || !count)
+		{
+			return error;
+		}
+
+		std::vector<cl_platform_id> ids( count);
+		error = clGetPlatformIDs( count, &ids[ 0], nullptr);
+		if ( error)
+		{
+			return error;
+		}
+
+		// best effort, as in the background discovery: failing platforms and devices are skipped and the first failure returned
+		cl_int failure = CL_SUCCESS;
+		DeviceRecordMap known;
+		for ( cl_uint i = 0; i < count; ++i)
+		{
+			Platform platform;
+			error = read( platform, ids[ i]);
+			if ( error)
+			{
+				failure = failure ? failure : error;
+				continue;
+			}
+
+			PlatformRecord record;
+			record.setId( ids[ i]);
+			record.setPlatform( platform);
+			error = discover( record.devices(), ids[ i], type, mode, known);
+			failure = failure ? failure : error;
+			platforms.push_back( record);
+		}
+
+		return failure;
+	}
+}
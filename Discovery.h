@@ -0,0 +1,147 @@
+#pragma once
+#ifndef PCHDR
+	#include "OpenCLInfo.h"
+	#include <map>
+	#include <memory>
+	#include <string>
+	#include <vector>
+#endif
+
+namespace Info
+{
+	class PciLocation
+	{
+	public:
+		PciLocation():
+			iDomain( 0),
+			iBus( 0),
+			iDevice( 0),
+			iFunction( 0),
+			iValid( false)
+		{}
+
+		uint domain() const { return iDomain; }
+		void setDomain( const uint value) { iDomain = value; }
+
+		uint bus() const { return iBus; }
+		void setBus( const uint value) { iBus = value; }
+
+		uint device() const { return iDevice; }
+		void setDevice( const uint value) { iDevice = value; }
+
+		uint function() const { return iFunction; }
+		void setFunction( const uint value) { iFunction = value; }
+
+		// false when the driver exposes no PCI location
+		bool isValid() const { return iValid; }
+		void setValid( const bool value) { iValid = value; }
+
+	private:
+		uint iDomain;
+		uint iBus;
+		uint iDevice;
+		uint iFunction;
+		bool iValid;
+	};
+
+	typedef std::shared_ptr<const Device> DeviceRecord;
+
+	// one physical device; the immutable record may be shared with identical devices
+	class DeviceInstance
+	{
+	public:
+		DeviceInstance():
+			iId( nullptr),
+			iAvailable( false),
+			iShared( false)
+		{}
+
+		cl_device_id id() const { return iId; }
+		void setId( const cl_device_id value) { iId = value; }
+
+		const DeviceRecord& record() const { return iRecord; }
+		void setRecord( const DeviceRecord& item) { iRecord = item; }
+
+		// per-instance; the record holds the value of the device it was read from
+		bool isAvailable() const { return iAvailable; }
+		void setAvailable( const bool value) { iAvailable = value; }
+
+		const PciLocation& pciLocation() const { return iPciLocation; }
+		void setPciLocation( const PciLocation& item) { iPciLocation = item; }
+
+		// true when the record was reused from an identical device
+		bool isShared() const { return iShared; }
+		void setShared( const bool value) { iShared = value; }
+
+	private:
+		DeviceRecord	iRecord;
+		PciLocation		iPciLocation;
+		cl_device_id	iId;
+		bool			iAvailable;
+		bool			iShared;
+	};
+
+	typedef std::vector<DeviceInstance> DeviceInstanceArray;
+
+	class PlatformRecord
+	{
+	public:
+		PlatformRecord():
+			iId( nullptr)
+		{}
+
+		cl_platform_id id() const { return iId; }
+		void setId( const cl_platform_id value) { iId = value; }
+
+		const Platform& platform() const { return iPlatform; }
+		void setPlatform( const Platform& item) { iPlatform = item; }
+
+		const DeviceInstanceArray& devices() const { return iDevices; }
+		DeviceInstanceArray& devices() { return iDevices; }
+		void setDevices( const DeviceInstanceArray& item) { iDevices = item; }
+
+	private:
+		Platform			iPlatform;
+		DeviceInstanceArray	iDevices;
+		cl_platform_id		iId;
+	};
+
+	typedef std::vector<PlatformRecord> PlatformRecordArray;
+
+	enum DeviceFlag
+	{
+		dfAvailable					= 1 << 0,
+		dfCompilerAvailable			= 1 << 1,
+		dfLinkerAvailable			= 1 << 2,
+		dfLittleEndian				= 1 << 3,
+		dfHostUnifiedMemory			= 1 << 4,
+		dfErrorCorrectionSupport	= 1 << 5,
+		dfImageSupport				= 1 << 6,
+		dfPciLocation				= 1 << 7,
+		dfCPU						= 1 << 8,
+		dfGPU						= 1 << 9,
+		dfAccelerator				= 1 << 10,
+		dfPreferredInteropUserSync	= 1 << 11
+	};
+
+	// DeviceFlag bits of the instance and its record
+	uint flags( const DeviceInstance& device);
+
+	enum DiscoveryMode
+	{
+		dmFull,
+		dmDeduplicate
+	};
+
+	// quick fingerprint -> record of the first device seen with it
+	typedef std::map<std::string, DeviceRecord> DeviceRecordMap;
+
+	// name, vendor id, driver version and global memory size
+	std::string quickFingerprint( const cl_device_id id);
+	PciLocation readPciLocation( const cl_device_id id, const uint vendorId);
+
+	void read( DeviceInstance& item, const cl_device_id id, const DiscoveryMode mode, DeviceRecordMap& known);
+	// skip platforms and devices that fail to read and return the first failure
+	cl_int discover( DeviceInstanceArray& devices, const cl_platform_id platform, const cl_device_type type, const DiscoveryMode mode, DeviceRecordMap& known);
+	cl_int discover( PlatformRecordArray& platforms, const cl_device_type type, const DiscoveryMode mode);
+}
@@ -0,0 +1,214 @@
+#include "stdafx.h"
+#include "File.h"
+#include <atomic>
+#include <cerrno>
+#include <sstream>
+
+#ifdef _WIN32
+	#include <windows.h>
+	#include <direct.h>
+	#include <process.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <sys/types.h>
+	#include <unistd.h>
+#endif
+
+namespace Info
+{
+	namespace File
+	{
+		namespace
+		{
+			unsigned long processId()
+			{
+			#ifdef _WIN32
+				return GetCurrentProcessId();
+			#else
+				return static_cast<unsigned long>( getpid());
+			#endif
+			}
+
+			bool replace( const std::string& from, const std::string& to)
+			{
+			#ifdef _WIN32
+				return MoveFileExA( from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+			#else
+				return ::rename( from.c_str(), to.c_str()) == 0;
+			#endif
+			}
+		}
+
+		bool read( std::vector<char>& content, const std::string& path)
+		{
+			std::ifstream file( path.c_str(), std::ios::binary | std::ios::ate);
+			if ( !file)
+			{
+				return false;
+			}
+
+			const auto size = static_cast<size_t>( file.tellg());
+			content.resize( size);
+			file.seekg( 0);
+			return size == 0 || file.read( &content[ 0], size).good();
+		}
+
+		bool size( unsigned long long& size, const std::string& path)
+		{
+			std::ifstream file( path.c_str(), std::ios::binary | std::ios::ate);
+			if ( !file)
+			{
+				return false;
+			}
+
+			size = static_cast<unsigned long long>( file.tellg());
+			return true;
+		}
+
+		bool writeAtomically( const std::string& path, const void* const data, const size_t size)
+		{
+			static std::atomic<unsigned int> counter( 0);
+
+			std::string temporary;
+			{
+				std::ostringstream stream;
+				stream << path << '.' << processId() << '.' << ++counter << ".tmp";
+				temporary = stream.str();
+			}
+
+			{
+				std::ofstream file( temporary.c_str(), std::ios::binary | std::ios::trunc);
+				if ( !file.write( static_cast<const char*>( data), size) || !file.flush())
+				{
+					file.close();
+					remove( temporary);
+					return false;
+				}
+			}
+
+			if ( !replace( temporary, path))
+			{
+				remove( temporary);
+				return false;
+			}
+
+			return true;
+		}
+
+		bool remove( const std::string& path)
+		{
+			return ::remove( path.c_str()) == 0;
+		}
+
+		bool makeDirectory( const std::string& path)
+		{
+		#ifdef _WIN32
+			return _mkdir( path.c_str()) == 0 || errno == EEXIST;
+		#else
+			return mkdir( path.c_str(), 0755) == 0 || errno == EEXIST;
+		#endif
+		}
+
+		std::string join( const std::string& directory, const std::string& name)
+		{
+			if ( directory.empty())
+			{
+				return name;
+			}
+
+			const auto last = directory[ directory.size() - 1];
+			return last == '/' || last == '\\' ? directory + name : directory + '/' + name;
+		}
+
+		Mapping::Mapping():
+			iData( nullptr),
+			iSize( 0),
+			iHandle( nullptr)
+		{}
+
+		Mapping::~Mapping()
+		{
+			close();
+		}
+
+		bool Mapping::open( const std::string& path)
+		{
+			close();
+		#ifdef _WIN32
+			const auto file = CreateFileA( path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if ( file == INVALID_HANDLE_VALUE)
+			{
+				return false;
+			}
+
+			LARGE_INTEGER size;
+			if ( !GetFileSizeEx( file, &size) || !size.QuadPart)
+			{
+				CloseHandle( file);
+				return false;
+			}
+
+			iHandle = CreateFileMappingA( file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			CloseHandle( file);
+			if ( !iHandle)
+			{
+				return false;
+			}
+
+			iData = MapViewOfFile( iHandle, FILE_MAP_READ, 0, 0, 0);
+			if ( !iData)
+			{
+				CloseHandle( iHandle);
+				iHandle = nullptr;
+				return false;
+			}
+
+			iSize = static_cast<size_t>( size.QuadPart);
+		#else
+			const int descriptor = ::open( path.c_str(), O_RDONLY);
+			if ( descriptor < 0)
+			{
+				return false;
+			}
+
+			struct stat status;
+			if ( fstat( descriptor, &status) || !status.st_size)
+			{
+				::close( descriptor);
+				return false;
+			}
+
+			const auto view = mmap( nullptr, static_cast<size_t>( status.st_size), PROT_READ, MAP_SHARED, descriptor, 0);
+			::close( descriptor);
+			if ( view == MAP_FAILED)
+			{
+				return false;
+			}
+
+			iData = view;
+			iSize = static_cast<size_t>( status.st_size);
+		#endif
+			return true;
+		}
+
+		void Mapping::close()
+		{
+			if ( !iData)
+			{
+				return;
+			}
+
+		#ifdef _WIN32
+			UnmapViewOfFile( iData);
+			CloseHandle( iHandle);
+		#else
+			munmap( const_cast<void*>( iData), iSize);
+		#endif
+			iData = nullptr;
+			iSize = 0;
+			iHandle = nullptr;
+		}
+	}
+}
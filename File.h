@@ -0,0 +1,46 @@
+#pragma once
+#ifndef PCHDR
+	#include <string>
+	#include <vector>
+#endif
+
+namespace Info
+{
+	namespace File
+	{
+		bool read( std::vector<char>& content, const std::string& path);
+
+		// writes to a temporary file next to path and renames it over path
+		bool writeAtomically( const std::string& path, const void* const data, const size_t size);
+
+		// false when the file cannot be opened
+		bool size( unsigned long long& size, const std::string& path);
+
+		bool remove( const std::string& path);
+		bool makeDirectory( const std::string& path);
+		std::string join( const std::string& directory, const std::string& name);
+
+		// read-only view of a whole file; the data is page aligned
+		class Mapping
+		{
+		public:
+			Mapping();
+			~Mapping();
+
+			bool open( const std::string& path);
+			void close();
+
+			bool isOpen() const { return iData != nullptr; }
+			const void* data() const { return iData; }
+			size_t size() const { return iSize; }
+
+		private:
+			Mapping( const Mapping&);
+			Mapping& operator=( const Mapping&);
+
+			const void*	iData;
+			size_t		iSize;
+			void*		iHandle;
+		};
+	}
+}
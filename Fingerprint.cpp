@@ -0,0 +1,78 @@
+#include "stdafx.h"
+#include "Fingerprint.h"
+
+namespace Info
+{
+	Hash& Hash::add( const void* const data, const size_t size)
+	{
+		auto p = static_cast<const byte*>( data);
+		for ( size_t i = 0; i < size; ++i)
+		{
+			iValue ^= p[ i];
+			iValue *= 1099511628211ULL;
+		}
+
+		return *this;
+	}
+
+	Hash& Hash::add( const std::string& item)
+	{
+		add( static_cast<ulong>( item.size()));
+		return add( item.data(), item.size());
+	}
+
+	Hash& Hash::add( const ulong value)
+	{
+		byte bytes[ 8];
+		for ( int i = 0; i < 8; ++i)
+		{
+			bytes[ i] = static_cast<byte>( value >> ( i * 8));
+		}
+
+		return add( bytes, 8);
+	}
+
+	std::string Hash::text() const
+	{
+		static const char digits[] = "0123456789abcdef";
+		std::string result( 16, '0');
+		for ( int i = 0; i < 16; ++i)
+		{
+			result[ 15 - i] = digits[ ( iValue >> ( i * 4)) & 0xF];
+		}
+
+		return result;
+	}
+
+	std::string fingerprint( const Device& device)
+	{
+		Hash hash;
+		hash.add( device.name()).add( device.vendor()).add( device.version()).add( device.driverVersion()).add( device.openClVersion()).add( device.profile());
+		hash.add( device.vendorId()).add( device.addressBits()).add( device.isLittleEndian() ? 1 : 0);
+		hash.add( device.maxComputeUnits()).add( device.maxClockFrequency()).add( device.maxWorkGroupSize()).add( device.maxWorkItemDimensions());
+		hash.add( device.maxConstantBufferSize()).add( device.maxConstantArgs()).add( device.maxParameterSize()).add( device.maxMemoryAllocSize());
+		hash.add( device.globalMemory().size()).add( device.localMemory().size()).add( device.minDataTypeAlignSize()).add( device.memoryBaseAddressAlignment());
+
+		for ( auto i = device.maxWorkItemSizes().begin(); i != device.maxWorkItemSizes().end(); ++i)
+		{
+			hash.add( static_cast<ulong>( *i));
+		}
+
+		for ( auto i = device.extensions().begin(); i != device.extensions().end(); ++i)
+		{
+			hash.add( *i);
+		}
+
+		for ( auto i = device.singleFpCapabilities().begin(); i != device.singleFpCapabilities().end(); ++i)
+		{
+			hash.add( static_cast<ulong>( *i));
+		}
+
+		for ( auto i = device.doubleFpCapabilities().begin(); i != device.doubleFpCapabilities().end(); ++i)
+		{
+			hash.add( static_cast<ulong>( *i) + 0x100);
+		}
+
+		return hash.text();
+	}
+}
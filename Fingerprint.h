@@ -0,0 +1,29 @@
+#pragma once
+#ifndef PCHDR
+	#include "OpenCLInfo.h"
+	#include <string>
+#endif
+
+namespace Info
+{
+	class Hash
+	{
+	public:
+		Hash():
+			iValue( 14695981039346656037ULL)
+		{}
+
+		Hash& add( const void* const data, const size_t size);
+		Hash& add( const std::string& item);
+		Hash& add( const ulong value);
+
+		ulong value() const { return iValue; }
+		std::string text() const;
+
+	private:
+		ulong iValue;
+	};
+
+	// identifies the device model, driver and every capability that affects compiled code
+	std::string fingerprint( const Device& device);
+}
@@ -0,0 +1,668 @@
+#include "stdafx.h"
+#include "FleetStore.h"
+#include "Serializer.h"
+#include <algorithm>
+#include <cstring>
+
+namespace Info
+{
+	namespace
+	{
+		const char* const columnNames[] =
+		{
+			"globalMemorySize",
+			"maxMemoryAllocSize",
+			"localMemorySize",
+			"maxConstantBufferSize",
+			"maxWorkGroupSize",
+			"maxComputeUnits",
+			"maxClockFrequency",
+			"vendorId"
+		};
+
+		// indexed by DeviceFlag bit
+		const char* const flagNames[] =
+		{
+			"available",
+			"compilerAvailable",
+			"linkerAvailable",
+			"littleEndian",
+			"hostUnifiedMemory",
+			"errorCorrectionSupport",
+			"imageSupport",
+			"pciLocation",
+			"cpu",
+			"gpu",
+			"accelerator",
+			"preferredInteropUserSync"
+		};
+
+		static_assert( sizeof(columnNames) / sizeof(columnNames[ 0]) == fleetColumnCount, "every column needs a name");
+		static_assert( sizeof(flagNames) / sizeof(flagNames[ 0]) == Fleet::flagCount, "every flag needs a name");
+
+		bool isDigit( const char c)
+		{
+			return c >= '0' && c <= '9';
+		}
+
+		size_t aligned( const size_t size)
+		{
+			return ( size + 7) & ~static_cast<size_t>( 7);
+		}
+
+		std::string trim( const std::string& text)
+		{
+			const auto first = text.find_first_not_of( " \t");
+			const auto last = text.find_last_not_of( " \t");
+			return first == std::string::npos ? std::string() : text.substr( first, last - first + 1);
+		}
+
+		// accepts a K, M or G suffix (binary multiples)
+		bool parseNumber( ulong& value, const std::string& text)
+		{
+			char* end = nullptr;
+			value = strtoull( text.c_str(), &end, 10);
+			if ( end == text.c_str())
+			{
+				return false;
+			}
+
+			switch ( *end)
+			{
+				case 'K': case 'k': value <<= 10; ++end; break;
+				case 'M': case 'm': value <<= 20; ++end; break;
+				case 'G': case 'g': value <<= 30; ++end; break;
+			}
+
+			return *end == 0;
+		}
+
+		// deduplicating heap of null terminated strings
+		class StringHeap
+		{
+		public:
+			uint add( const std::string& item)
+			{
+				const auto found = iOffsets.find( item);
+				if ( found != iOffsets.end())
+				{
+					return found->second;
+				}
+
+				const auto offset = static_cast<uint>( iData.size());
+				iData.insert( iData.end(), item.begin(), item.end());
+				iData.push_back( 0);
+				iOffsets[ item] = offset;
+				return offset;
+			}
+
+			const std::vector<char>& data() const { return iData; }
+
+		private:
+			std::map<std::string, uint>	iOffsets;
+			std::vector<char>			iData;
+		};
+	}
+
+	const char* columnName( const FleetColumn column)
+	{
+		return columnNames[ column];
+	}
+
+	bool findColumn( FleetColumn& column, const std::string& name)
+	{
+		for ( int c = 0; c < fleetColumnCount; ++c)
+		{
+			if ( name == columnNames[ c])
+			{
+				column = static_cast<FleetColumn>( c);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	bool findFlag( uint& flag, const std::string& name)
+	{
+		for ( uint f = 0; f < Fleet::flagCount; ++f)
+		{
+			if ( name == flagNames[ f])
+			{
+				flag = 1u << f;
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	const char* flagName( const uint bit)
+	{
+		return bit < Fleet::flagCount ? flagNames[ bit] : "";
+	}
+
+	int compareVersions( const char* first, const char* second)
+	{
+		while ( *first && *second)
+		{
+			if ( isDigit( *first) && isDigit( *second))
+			{
+				while ( *first == '0')
+				{
+					++first;
+				}
+
+				while ( *second == '0')
+				{
+					++second;
+				}
+
+				size_t firstLength = 0;
+				size_t secondLength = 0;
+				while ( isDigit( first[ firstLength]))
+				{
+					++firstLength;
+				}
+
+				while ( isDigit( second[ secondLength]))
+				{
+					++secondLength;
+				}
+
+				if ( firstLength != secondLength)
+				{
+					return firstLength < secondLength ? -1 : 1;
+				}
+
+				const auto order = strncmp( first, second, firstLength);
+				if ( order)
+				{
+					return order < 0 ? -1 : 1;
+				}
+
+				first += firstLength;
+				second += secondLength;
+				continue;
+			}
+
+			if ( *first != *second)
+			{
+				return static_cast<unsigned char>( *first) < static_cast<unsigned char>( *second) ? -1 : 1;
+			}
+
+			++first;
+			++second;
+		}
+
+		return *first ? 1 : *second ? -1 : 0;
+	}
+
+	bool FleetStoreBuilder::add( const std::string& node, const void* const data, const size_t size)
+	{
+		BinaryReader reader( data, size);
+		if ( !reader.isValid())
+		{
+			return false;
+		}
+
+		const auto nodeIndex = static_cast<uint>( iNodes.size());
+		const auto firstRow = iRows.size();
+		for ( uint p = 0; p < reader.header().platformCount; ++p)
+		{
+			PlatformView platform;
+			if ( !reader.next( platform))
+			{
+				iRows.resize( firstRow);
+				return false;
+			}
+
+			for ( uint d = 0; d < platform.deviceCount(); ++d)
+			{
+				DeviceView device;
+				if ( !reader.next( device))
+				{
+					iRows.resize( firstRow);
+					return false;
+				}
+
+				const auto& block = device.block();
+				Row row;
+				row.values[ fcGlobalMemorySize] = block.globalMemorySize;
+				row.values[ fcMaxMemoryAllocSize] = block.maxMemoryAllocSize;
+				row.values[ fcLocalMemorySize] = block.localMemorySize;
+				row.values[ fcMaxConstantBufferSize] = block.maxConstantBufferSize;
+				row.values[ fcMaxWorkGroupSize] = block.maxWorkGroupSize;
+				row.values[ fcMaxComputeUnits] = block.maxComputeUnits;
+				row.values[ fcMaxClockFrequency] = block.maxClockFrequency;
+				row.values[ fcVendorId] = block.vendorId;
+				row.node = nodeIndex;
+				row.flags = block.flags;
+				row.name = device.string( Binary::dsName).str();
+				row.driverVersion = device.string( Binary::dsDriverVersion).str();
+
+				const auto text = device.string( Binary::dsExtensions);
+				const auto end = text.data() + text.size();
+				for ( auto start = text.data(); start < end;)
+				{
+					auto stop = static_cast<const char*>( memchr( start, ' ', end - start));
+					stop = stop ? stop : end;
+					if ( stop != start)
+					{
+						const auto inserted = iExtensions.insert( ExtensionMap::value_type( std::string( start, stop), static_cast<uint>( iExtensions.size())));
+						row.extensions.push_back( inserted.first->second);
+					}
+
+					start = stop + 1;
+				}
+
+				iRows.push_back( row);
+			}
+		}
+
+		iNodes.push_back( node);
+		return true;
+	}
+
+	bool FleetStoreBuilder::write( const std::string& path) const
+	{
+		const auto rowCount = iRows.size();
+		const auto words = ( rowCount + 63) / 64;
+
+		// extension ids were handed out in arrival order; the file keeps them sorted by name
+		std::vector<uint> extensionOrder( iExtensions.size());
+		{
+			uint sorted = 0;
+			for ( auto i = iExtensions.begin(); i != iExtensions.end(); ++i)
+			{
+				extensionOrder[ i->second] = sorted++;
+			}
+		}
+
+		Fleet::Header header;
+		memset( &header, 0, sizeof(header));
+		header.magic = Fleet::magic;
+		header.version = Fleet::version;
+		header.rowCount = static_cast<uint>( rowCount);
+		header.nodeCount = static_cast<uint>( iNodes.size());
+		header.extensionCount = static_cast<uint>( iExtensions.size());
+		header.words = static_cast<uint>( words);
+
+		StringHeap strings;
+		std::vector<uint> rowStrings( 2 * rowCount);
+		for ( size_t r = 0; r < rowCount; ++r)
+		{
+			rowStrings[ 2 * r] = strings.add( iRows[ r].name);
+			rowStrings[ 2 * r + 1] = strings.add( iRows[ r].driverVersion);
+		}
+
+		std::vector<uint> extensionNames;
+		for ( auto i = iExtensions.begin(); i != iExtensions.end(); ++i)
+		{
+			extensionNames.push_back( strings.add( i->first));
+		}
+
+		std::vector<uint> nodeNames;
+		for ( auto i = iNodes.begin(); i != iNodes.end(); ++i)
+		{
+			nodeNames.push_back( strings.add( *i));
+		}
+
+		{
+			const size_t sizes[ Fleet::sectionCount] =
+			{
+				fleetColumnCount * rowCount * sizeof(ulong),
+				fleetColumnCount * rowCount * sizeof(uint),
+				Fleet::flagCount * words * sizeof(ulong),
+				iExtensions.size() * words * sizeof(ulong),
+				rowCount * sizeof(uint),
+				rowStrings.size() * sizeof(uint),
+				extensionNames.size() * sizeof(uint),
+				nodeNames.size() * sizeof(uint),
+				strings.data().size()
+			};
+
+			size_t offset = aligned( sizeof(header));
+			for ( int s = 0; s < Fleet::sectionCount; ++s)
+			{
+				header.sections[ s].offset = offset;
+				header.sections[ s].size = sizes[ s];
+				offset = aligned( offset + sizes[ s]);
+			}
+		}
+
+		const auto& last = header.sections[ Fleet::sectionCount - 1];
+		std::vector<char> content( aligned( static_cast<size_t>( last.offset + last.size)));
+		memcpy( &content[ 0], &header, sizeof(header));
+
+		auto base = &content[ 0];
+		auto columns = reinterpret_cast<ulong*>( base + header.sections[ Fleet::sColumns].offset);
+		auto sorted = reinterpret_cast<uint*>( base + header.sections[ Fleet::sSorted].offset);
+		for ( int c = 0; c < fleetColumnCount; ++c)
+		{
+			auto values = columns + c * rowCount;
+			auto order = sorted + c * rowCount;
+			for ( size_t r = 0; r < rowCount; ++r)
+			{
+				values[ r] = iRows[ r].values[ c];
+				order[ r] = static_cast<uint>( r);
+			}
+
+			std::stable_sort( order, order + rowCount, [values]( const uint a, const uint b) { return values[ a] < values[ b]; });
+		}
+
+		auto flagBitmaps = reinterpret_cast<ulong*>( base + header.sections[ Fleet::sFlagBitmaps].offset);
+		auto extensionBitmaps = reinterpret_cast<ulong*>( base + header.sections[ Fleet::sExtensionBitmaps].offset);
+		auto rowNodes = reinterpret_cast<uint*>( base + header.sections[ Fleet::sRowNodes].offset);
+		for ( size_t r = 0; r < rowCount; ++r)
+		{
+			const auto& row = iRows[ r];
+			const auto bit = 1ull << ( r % 64);
+			for ( uint f = 0; f < Fleet::flagCount; ++f)
+			{
+				if ( row.flags & ( 1u << f))
+				{
+					flagBitmaps[ f * words + r / 64] |= bit;
+				}
+			}
+
+			for ( auto e = row.extensions.begin(); e != row.extensions.end(); ++e)
+			{
+				extensionBitmaps[ extensionOrder[ *e] * words + r / 64] |= bit;
+			}
+
+			rowNodes[ r] = row.node;
+		}
+
+		if ( !rowStrings.empty())
+		{
+			memcpy( base + header.sections[ Fleet::sRowStrings].offset, &rowStrings[ 0], rowStrings.size() * sizeof(uint));
+		}
+
+		if ( !extensionNames.empty())
+		{
+			memcpy( base + header.sections[ Fleet::sExtensionNames].offset, &extensionNames[ 0], extensionNames.size() * sizeof(uint));
+		}
+
+		if ( !nodeNames.empty())
+		{
+			memcpy( base + header.sections[ Fleet::sNodeNames].offset, &nodeNames[ 0], nodeNames.size() * sizeof(uint));
+		}
+
+		if ( !strings.data().empty())
+		{
+			memcpy( base + header.sections[ Fleet::sStrings].offset, &strings.data()[ 0], strings.data().size());
+		}
+
+		return File::writeAtomically( path, base, content.size());
+	}
+
+	FleetQuery& FleetQuery::atLeast( const FleetColumn column, const ulong value)
+	{
+		iMinimum[ column] = std::max( iMinimum[ column], value);
+		return *this;
+	}
+
+	FleetQuery& FleetQuery::atMost( const FleetColumn column, const ulong value)
+	{
+		iMaximum[ column] = std::min( iMaximum[ column], value);
+		return *this;
+	}
+
+	bool FleetQuery::parse( const std::string& text)
+	{
+		size_t start = 0;
+		while ( start <= text.size())
+		{
+			auto stop = text.find( ',', start);
+			stop = stop == std::string::npos ? text.size() : stop;
+			const auto term = trim( text.substr( start, stop - start));
+			start = stop + 1;
+			if ( term.empty())
+			{
+				continue;
+			}
+
+			const auto op = term.find_first_of( "<>=");
+			if ( op == std::string::npos)
+			{
+				uint flag;
+				if ( findFlag( flag, term))
+				{
+					requireFlags( flag);
+				}
+				else
+				{
+					requireExtension( term);
+				}
+
+				continue;
+			}
+
+			const auto name = trim( term.substr( 0, op));
+			const auto relation = term[ op];
+			const auto strict = relation != '=' && term[ op + 1] != '=';
+			const auto argument = trim( term.substr( strict ? op + 1 : op + 2));
+			if ( name == "driverVersion")
+			{
+				// driver versions are only ordered for >=
+				if ( relation != '>' || strict)
+				{
+					return false;
+				}
+
+				driverAtLeast( argument);
+				continue;
+			}
+
+			FleetColumn column;
+			ulong value;
+			if ( !findColumn( column, name) || !parseNumber( value, argument))
+			{
+				return false;
+			}
+
+			// strict bounds that exclude every value leave an empty range
+			if ( strict && value == ( relation == '>' ? ~0ull : 0))
+			{
+				atLeast( column, 1);
+				atMost( column, 0);
+				continue;
+			}
+
+			if ( relation != '<')
+			{
+				atLeast( column, strict ? value + 1 : value);
+			}
+
+			if ( relation != '>')
+			{
+				atMost( column, strict ? value - 1 : value);
+			}
+		}
+
+		return true;
+	}
+
+	bool FleetStore::open( const std::string& path)
+	{
+		iHeader = nullptr;
+		if ( !iFile.open( path) || iFile.size() < sizeof(Fleet::Header))
+		{
+			return false;
+		}
+
+		const auto header = static_cast<const Fleet::Header*>( iFile.data());
+		if ( header->magic != Fleet::magic || header->version != Fleet::version)
+		{
+			return false;
+		}
+
+		const ulong rows = header->rowCount;
+		const ulong words = header->words;
+		const ulong expected[ Fleet::sectionCount - 1] =
+		{
+			fleetColumnCount * rows * sizeof(ulong),
+			fleetColumnCount * rows * sizeof(uint),
+			Fleet::flagCount * words * sizeof(ulong),
+			header->extensionCount * words * sizeof(ulong),
+			rows * sizeof(uint),
+			2 * rows * sizeof(uint),
+			header->extensionCount * sizeof(uint),
+			header->nodeCount * sizeof(uint)
+		};
+
+		if ( words != ( rows + 63) / 64)
+		{
+			return false;
+		}
+
+		for ( int s = 0; s < Fleet::sectionCount; ++s)
+		{
+			const auto& entry = header->sections[ s];
+			if ( entry.offset % 8 || entry.offset > iFile.size() || entry.size > iFile.size() - entry.offset ||
+				( s < Fleet::sectionCount - 1 && entry.size != expected[ s]))
+			{
+				return false;
+			}
+		}
+
+		// every string offset must land inside the null terminated heap
+		const auto& heap = header->sections[ Fleet::sStrings];
+		const auto strings = static_cast<const char*>( iFile.data()) + heap.offset;
+		if ( heap.size && strings[ heap.size - 1])
+		{
+			return false;
+		}
+
+		for ( int s = Fleet::sRowStrings; s <= Fleet::sNodeNames; ++s)
+		{
+			const auto offsets = reinterpret_cast<const uint*>( static_cast<const char*>( iFile.data()) + header->sections[ s].offset);
+			for ( ulong i = 0; i < header->sections[ s].size / sizeof(uint); ++i)
+			{
+				if ( offsets[ i] >= heap.size)
+				{
+					return false;
+				}
+			}
+		}
+
+		const auto nodes = reinterpret_cast<const uint*>( static_cast<const char*>( iFile.data()) + header->sections[ Fleet::sRowNodes].offset);
+		for ( ulong r = 0; r < rows; ++r)
+		{
+			if ( nodes[ r] >= header->nodeCount)
+			{
+				return false;
+			}
+		}
+
+		// the sorted columns index rows directly
+		const auto sorted = reinterpret_cast<const uint*>( static_cast<const char*>( iFile.data()) + header->sections[ Fleet::sSorted].offset);
+		for ( ulong i = 0; i < fleetColumnCount * rows; ++i)
+		{
+			if ( sorted[ i] >= rows)
+			{
+				return false;
+			}
+		}
+
+		iHeader = header;
+		return true;
+	}
+
+	const ulong* FleetStore::extensionBitmap( const std::string& name) const
+	{
+		const auto names = section<uint>( Fleet::sExtensionNames);
+		const auto end = names + iHeader->extensionCount;
+		const auto found = std::lower_bound( names, end, name, [this]( const uint offset, const std::string& item) { return strcmp( string( offset), item.c_str()) < 0; });
+		if ( found == end || name != string( *found))
+		{
+			return nullptr;
+		}
+
+		return section<ulong>( Fleet::sExtensionBitmaps) + ( found - names) * static_cast<size_t>( iHeader->words);
+	}
+
+	void FleetStore::filter( std::vector<ulong>& bitmap, const FleetColumn column, const ulong minimum, const ulong maximum) const
+	{
+		const auto rows = static_cast<size_t>( rowCount());
+		const auto values = columns() + column * rows;
+		const auto sorted = section<uint>( Fleet::sSorted) + column * rows;
+		const auto first = std::lower_bound( sorted, sorted + rows, minimum, [values]( const uint row, const ulong value) { return values[ row] < value; });
+		const auto last = std::upper_bound( first, sorted + rows, maximum, [values]( const ulong value, const uint row) { return value < values[ row]; });
+
+		std::vector<ulong> range( bitmap.size(), 0);
+		for ( auto i = first; i != last; ++i)
+		{
+			range[ *i / 64] |= 1ull << ( *i % 64);
+		}
+
+		for ( size_t w = 0; w < bitmap.size(); ++w)
+		{
+			bitmap[ w] &= range[ w];
+		}
+	}
+
+	void FleetStore::select( std::vector<uint>& rows, const FleetQuery& query) const
+	{
+		rows.clear();
+		const auto words = static_cast<size_t>( iHeader->words);
+		std::vector<ulong> bitmap( words, ~0ull);
+		if ( rowCount() % 64)
+		{
+			bitmap[ words - 1] = ( 1ull << ( rowCount() % 64)) - 1;
+		}
+
+		for ( uint f = 0; f < Fleet::flagCount; ++f)
+		{
+			if ( query.iFlags & ( 1u << f))
+			{
+				const auto flags = section<ulong>( Fleet::sFlagBitmaps) + f * words;
+				for ( size_t w = 0; w < words; ++w)
+				{
+					bitmap[ w] &= flags[ w];
+				}
+			}
+		}
+
+		for ( auto i = query.iExtensions.begin(); i != query.iExtensions.end(); ++i)
+		{
+			const auto extension = extensionBitmap( *i);
+			if ( !extension)
+			{
+				return;
+			}
+
+			for ( size_t w = 0; w < words; ++w)
+			{
+				bitmap[ w] &= extension[ w];
+			}
+		}
+
+		for ( int c = 0; c < fleetColumnCount; ++c)
+		{
+			if ( query.iMinimum[ c] || query.iMaximum[ c] != ~0ull)
+			{
+				filter( bitmap, static_cast<FleetColumn>( c), query.iMinimum[ c], query.iMaximum[ c]);
+			}
+		}
+
+		for ( size_t w = 0; w < words; ++w)
+		{
+			for ( auto bits = bitmap[ w]; bits; bits &= bits - 1)
+			{
+				uint bit = 0;
+				while ( !( bits & ( 1ull << bit)))
+				{
+					++bit;
+				}
+
+				const auto row = static_cast<uint>( w * 64 + bit);
+				if ( query.iDriverVersion.empty() || compareVersions( driverVersion( row), query.iDriverVersion.c_str()) >= 0)
+				{
+					rows.push_back( row);
+				}
+			}
+		}
+	}
+}
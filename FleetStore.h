@@ -0,0 +1,182 @@
+#pragma once
+#ifndef PCHDR
+	#include "Discovery.h"
+	#include "File.h"
+	#include <map>
+	#include <string>
+	#include <vector>
+#endif
+
+namespace Info
+{
+	// numeric fields with a sorted index in the store
+	enum FleetColumn
+	{
+		fcGlobalMemorySize,
+		fcMaxMemoryAllocSize,
+		fcLocalMemorySize,
+		fcMaxConstantBufferSize,
+		fcMaxWorkGroupSize,
+		fcMaxComputeUnits,
+		fcMaxClockFrequency,
+		fcVendorId,
+		fleetColumnCount
+	};
+
+	const char* columnName( const FleetColumn column);
+	bool findColumn( FleetColumn& column, const std::string& name);
+
+	// DeviceFlag bits by the name used in queries, e.g. "gpu" or "imageSupport"
+	bool findFlag( uint& flag, const std::string& name);
+	const char* flagName( const uint bit);
+
+	// compares digit runs numerically, so "450.80" < "450.102" and "9.1" < "10.0"
+	int compareVersions( const char* first, const char* second);
+
+	// One row per device. Every section of the file is 8-byte aligned so the
+	// store can be used straight from a read-only mapping.
+	namespace Fleet
+	{
+		enum
+		{
+			magic	= 0x464C434F,	// "OCLF"
+			version	= 1,
+			flagCount = 12			// DeviceFlag bits
+		};
+
+		enum Section
+		{
+			sColumns,			// fleetColumnCount x rowCount ulong
+			sSorted,			// fleetColumnCount x rowCount uint, row ids by ascending value
+			sFlagBitmaps,		// flagCount x words ulong
+			sExtensionBitmaps,	// extensionCount x words ulong
+			sRowNodes,			// rowCount uint
+			sRowStrings,		// rowCount x (name, driverVersion) uint offsets into sStrings
+			sExtensionNames,	// extensionCount uint offsets, sorted by name
+			sNodeNames,			// nodeCount uint offsets
+			sStrings,			// null terminated
+			sectionCount
+		};
+
+		class SectionEntry
+		{
+		public:
+			ulong	offset;
+			ulong	size;
+		};
+
+		class Header
+		{
+		public:
+			uint			magic;
+			uint			version;
+			uint			rowCount;
+			uint			nodeCount;
+			uint			extensionCount;
+			uint			words;			// ulongs per bitmap
+			SectionEntry	sections[ sectionCount];
+		};
+	}
+
+	// accumulates snapshots and writes the indexed store
+	class FleetStoreBuilder
+	{
+	public:
+		// false when the snapshot is not a valid binary snapshot
+		bool add( const std::string& node, const void* const data, const size_t size);
+		bool write( const std::string& path) const;
+
+		size_t rowCount() const { return iRows.size(); }
+
+	private:
+		class Row
+		{
+		public:
+			ulong				values[ fleetColumnCount];
+			uint				node;
+			uint				flags;
+			std::string			name;
+			std::string			driverVersion;
+			std::vector<uint>	extensions;
+		};
+
+		typedef std::map<std::string, uint> ExtensionMap;
+
+		std::vector<Row>			iRows;
+		std::vector<std::string>	iNodes;
+		ExtensionMap				iExtensions;
+	};
+
+	class FleetQuery
+	{
+	public:
+		FleetQuery():
+			iFlags( 0)
+		{
+			for ( int c = 0; c < fleetColumnCount; ++c)
+			{
+				iMinimum[ c] = 0;
+				iMaximum[ c] = ~0ull;
+			}
+		}
+
+		FleetQuery& requireExtension( const std::string& name) { iExtensions.push_back( name); return *this; }
+		FleetQuery& requireFlags( const uint flags) { iFlags |= flags; return *this; }
+		FleetQuery& atLeast( const FleetColumn column, const ulong value);
+		FleetQuery& atMost( const FleetColumn column, const ulong value);
+		FleetQuery& driverAtLeast( const std::string& version) { iDriverVersion = version; return *this; }
+
+		// comma separated terms: an extension, a flag name, "column>=n", "column>n", "column<=n", "column<n", "column=n" or "driverVersion>=x"
+		bool parse( const std::string& text);
+
+	private:
+		friend class FleetStore;
+
+		std::vector<std::string>	iExtensions;
+		std::string					iDriverVersion;
+		ulong						iMinimum[ fleetColumnCount];
+		ulong						iMaximum[ fleetColumnCount];
+		uint						iFlags;
+	};
+
+	// queries a store file in place
+	class FleetStore
+	{
+	public:
+		FleetStore():
+			iHeader( nullptr)
+		{}
+
+		bool open( const std::string& path);
+		bool isOpen() const { return iHeader != nullptr; }
+
+		uint rowCount() const { return iHeader->rowCount; }
+		uint nodeCount() const { return iHeader->nodeCount; }
+
+		// matching rows in ascending order
+		void select( std::vector<uint>& rows, const FleetQuery& query) const;
+
+		ulong value( const uint row, const FleetColumn column) const { return columns()[ column * static_cast<size_t>( rowCount()) + row]; }
+		uint node( const uint row) const { return section<uint>( Fleet::sRowNodes)[ row]; }
+		const char* nodeName( const uint node) const { return string( section<uint>( Fleet::sNodeNames)[ node]); }
+		const char* deviceName( const uint row) const { return string( section<uint>( Fleet::sRowStrings)[ 2 * row]); }
+		const char* driverVersion( const uint row) const { return string( section<uint>( Fleet::sRowStrings)[ 2 * row + 1]); }
+
+	private:
+		template <typename T>
+		const T* section( const Fleet::Section index) const
+		{
+			return reinterpret_cast<const T*>( static_cast<const char*>( iFile.data()) + iHeader->sections[ index].offset);
+		}
+
+		const ulong* columns() const { return section<ulong>( Fleet::sColumns); }
+		const char* string( const uint offset) const { return section<char>( Fleet::sStrings) + offset; }
+		const ulong* extensionBitmap( const std::string& name) const;
+
+		// clears the bits of rows whose value lies outside [minimum, maximum]
+		void filter( std::vector<ulong>& bitmap, const FleetColumn column, const ulong minimum, const ulong maximum) const;
+
+		File::Mapping			iFile;
+		const Fleet::Header*	iHeader;
+	};
+}
@@ -0,0 +1,698 @@
+#include "stdafx.h"
+#include "HostBaseline.h"
+#include "ProgramCache.h"
+#include <algorithm>
+
+#if defined( _M_IX86) || defined( _M_X64) || defined( __i386__) || defined( __x86_64__)
+	#define INFO_X86
+	#include <immintrin.h>
+
+	#ifdef _MSC_VER
+		#include <intrin.h>
+
+		// intrinsics compile for any ISA; AVX-512 ones arrived with Visual Studio 2017
+		#define INFO_TARGET( isa)
+		#if _MSC_VER >= 1910
+			#define INFO_AVX512
+		#endif
+	#else
+		#include <cpuid.h>
+
+		#define INFO_TARGET( isa) __attribute__(( target( isa)))
+		#define INFO_AVX512
+	#endif
+#endif
+
+namespace Info
+{
+	namespace
+	{
+		const float chainMultiplier = 0.999f;
+		const float chainAddend = 0.001f;
+		const float triadScale = 3.0f;
+
+		// independent accumulators per block of the FMA chain, enough to hide the FMA latency
+		const int chainLanes = 8;
+
+		const char* const kernelSource =
+			"__kernel void copy( __global float* a, __global const float* b)\n"
+			"{\n"
+			"	const size_t i = get_global_id( 0);\n"
+			"	a[ i] = b[ i];\n"
+			"}\n"
+			"\n"
+			"__kernel void triad( __global float* a, __global const float* b, __global const float* c, const float s)\n"
+			"{\n"
+			"	const size_t i = get_global_id( 0);\n"
+			"	a[ i] = b[ i] + s * c[ i];\n"
+			"}\n"
+			"\n"
+			"__kernel void fmaChain( __global float* a, const uint chain)\n"
+			"{\n"
+			"	const size_t i = get_global_id( 0);\n"
+			"	float x = a[ i];\n"
+			"	for ( uint k = 0; k < chain; ++k)\n"
+			"	{\n"
+			"		x = fma( x, 0.999f, 0.001f);\n"
+			"	}\n"
+			"\n"
+			"	a[ i] = x;\n"
+			"}\n";
+
+		const char* const kernelNames[] = { "copy", "triad", "fmaChain" };
+		const char* const isaNames[] = { "scalar", "SSE4.2", "AVX2", "AVX-512" };
+
+		void check( const cl_int error, const char* const function)
+		{
+			if ( error)
+			{
+				throw ApiException( function, error);
+			}
+		}
+
+		void copyScalar( float* const a, const float* const b, const size_t n)
+		{
+			for ( size_t i = 0; i < n; ++i)
+			{
+				a[ i] = b[ i];
+			}
+		}
+
+		void triadScalar( float* const a, const float* const b, const float* const c, const float s, const size_t n)
+		{
+			for ( size_t i = 0; i < n; ++i)
+			{
+				a[ i] = b[ i] + s * c[ i];
+			}
+		}
+
+		void chainScalar( float* const a, const size_t n, const uint chain)
+		{
+			for ( size_t i = 0; i < n; ++i)
+			{
+				float x = a[ i];
+				for ( uint k = 0; k < chain; ++k)
+				{
+					x = x * chainMultiplier + chainAddend;
+				}
+
+				a[ i] = x;
+			}
+		}
+
+	#ifdef INFO_X86
+		void cpuid( int info[ 4], const int leaf, const int subleaf)
+		{
+		#ifdef _MSC_VER
+			__cpuidex( info, leaf, subleaf);
+		#else
+			unsigned int registers[ 4];
+			__cpuid_count( leaf, subleaf, registers[ 0], registers[ 1], registers[ 2], registers[ 3]);
+			for ( int r = 0; r < 4; ++r)
+			{
+				info[ r] = static_cast<int>( registers[ r]);
+			}
+		#endif
+		}
+
+		// register state the operating system saves on context switches
+		unsigned long long enabledState()
+		{
+		#ifdef _MSC_VER
+			return _xgetbv( 0);
+		#else
+			unsigned int low, high;
+			__asm__ __volatile__( "xgetbv" : "=a"( low), "=d"( high) : "c"( 0));
+			return static_cast<unsigned long long>( high) << 32 | low;
+		#endif
+		}
+
+		INFO_TARGET( "sse4.2") void copySse( float* const a, const float* const b, const size_t n)
+		{
+			size_t i = 0;
+			for ( ; i + 4 <= n; i += 4)
+			{
+				_mm_storeu_ps( a + i, _mm_loadu_ps( b + i));
+			}
+
+			copyScalar( a + i, b + i, n - i);
+		}
+
+		INFO_TARGET( "sse4.2") void triadSse( float* const a, const float* const b, const float* const c, const float s, const size_t n)
+		{
+			const auto scale = _mm_set1_ps( s);
+			size_t i = 0;
+			for ( ; i + 4 <= n; i += 4)
+			{
+				_mm_storeu_ps( a + i, _mm_add_ps( _mm_loadu_ps( b + i), _mm_mul_ps( scale, _mm_loadu_ps( c + i))));
+			}
+
+			triadScalar( a + i, b + i, c + i, s, n - i);
+		}
+
+		INFO_TARGET( "sse4.2") void chainSse( float* const a, const size_t n, const uint chain)
+		{
+			const auto multiplier = _mm_set1_ps( chainMultiplier);
+			const auto addend = _mm_set1_ps( chainAddend);
+			size_t i = 0;
+			for ( ; i + 4 * chainLanes <= n; i += 4 * chainLanes)
+			{
+				__m128 x[ chainLanes];
+				for ( int l = 0; l < chainLanes; ++l)
+				{
+					x[ l] = _mm_loadu_ps( a + i + 4 * l);
+				}
+
+				for ( uint k = 0; k < chain; ++k)
+				{
+					for ( int l = 0; l < chainLanes; ++l)
+					{
+						x[ l] = _mm_add_ps( _mm_mul_ps( x[ l], multiplier), addend);
+					}
+				}
+
+				for ( int l = 0; l < chainLanes; ++l)
+				{
+					_mm_storeu_ps( a + i + 4 * l, x[ l]);
+				}
+			}
+
+			chainScalar( a + i, n - i, chain);
+		}
+
+		INFO_TARGET( "avx2,fma") void copyAvx2( float* const a, const float* const b, const size_t n)
+		{
+			size_t i = 0;
+			for ( ; i + 8 <= n; i += 8)
+			{
+				_mm256_storeu_ps( a + i, _mm256_loadu_ps( b + i));
+			}
+
+			copyScalar( a + i, b + i, n - i);
+		}
+
+		INFO_TARGET( "avx2,fma") void triadAvx2( float* const a, const float* const b, const float* const c, const float s, const size_t n)
+		{
+			const auto scale = _mm256_set1_ps( s);
+			size_t i = 0;
+			for ( ; i + 8 <= n; i += 8)
+			{
+				_mm256_storeu_ps( a + i, _mm256_fmadd_ps( scale, _mm256_loadu_ps( c + i), _mm256_loadu_ps( b + i)));
+			}
+
+			triadScalar( a + i, b + i, c + i, s, n - i);
+		}
+
+		INFO_TARGET( "avx2,fma") void chainAvx2( float* const a, const size_t n, const uint chain)
+		{
+			const auto multiplier = _mm256_set1_ps( chainMultiplier);
+			const auto addend = _mm256_set1_ps( chainAddend);
+			size_t i = 0;
+			for ( ; i + 8 * chainLanes <= n; i += 8 * chainLanes)
+			{
+				__m256 x[ chainLanes];
+				for ( int l = 0; l < chainLanes; ++l)
+				{
+					x[ l] = _mm256_loadu_ps( a + i + 8 * l);
+				}
+
+				for ( uint k = 0; k < chain; ++k)
+				{
+					for ( int l = 0; l < chainLanes; ++l)
+					{
+						x[ l] = _mm256_fmadd_ps( x[ l], multiplier, addend);
+					}
+				}
+
+				for ( int l = 0; l < chainLanes; ++l)
+				{
+					_mm256_storeu_ps( a + i + 8 * l, x[ l]);
+				}
+			}
+
+			chainScalar( a + i, n - i, chain);
+		}
+
+	#ifdef INFO_AVX512
+		INFO_TARGET( "avx512f") void copyAvx512( float* const a, const float* const b, const size_t n)
+		{
+			size_t i = 0;
+			for ( ; i + 16 <= n; i += 16)
+			{
+				_mm512_storeu_ps( a + i, _mm512_loadu_ps( b + i));
+			}
+
+			copyScalar( a + i, b + i, n - i);
+		}
+
+		INFO_TARGET( "avx512f") void triadAvx512( float* const a, const float* const b, const float* const c, const float s, const size_t n)
+		{
+			const auto scale = _mm512_set1_ps( s);
+			size_t i = 0;
+			for ( ; i + 16 <= n; i += 16)
+			{
+				_mm512_storeu_ps( a + i, _mm512_fmadd_ps( scale, _mm512_loadu_ps( c + i), _mm512_loadu_ps( b + i)));
+			}
+
+			triadScalar( a + i, b + i, c + i, s, n - i);
+		}
+
+		INFO_TARGET( "avx512f") void chainAvx512( float* const a, const size_t n, const uint chain)
+		{
+			const auto multiplier = _mm512_set1_ps( chainMultiplier);
+			const auto addend = _mm512_set1_ps( chainAddend);
+			size_t i = 0;
+			for ( ; i + 16 * chainLanes <= n; i += 16 * chainLanes)
+			{
+				__m512 x[ chainLanes];
+				for ( int l = 0; l < chainLanes; ++l)
+				{
+					x[ l] = _mm512_loadu_ps( a + i + 16 * l);
+				}
+
+				for ( uint k = 0; k < chain; ++k)
+				{
+					for ( int l = 0; l < chainLanes; ++l)
+					{
+						x[ l] = _mm512_fmadd_ps( x[ l], multiplier, addend);
+					}
+				}
+
+				for ( int l = 0; l < chainLanes; ++l)
+				{
+					_mm512_storeu_ps( a + i + 16 * l, x[ l]);
+				}
+			}
+
+			chainScalar( a + i, n - i, chain);
+		}
+	#endif
+	#endif
+
+		typedef void ( *CopyFunction)( float* const a, const float* const b, const size_t n);
+		typedef void ( *TriadFunction)( float* const a, const float* const b, const float* const c, const float s, const size_t n);
+		typedef void ( *ChainFunction)( float* const a, const size_t n, const uint chain);
+
+		class KernelSet
+		{
+		public:
+			CopyFunction	copy;
+			TriadFunction	triad;
+			ChainFunction	chain;
+		};
+
+		KernelSet kernels( const IsaLevel isa)
+		{
+			KernelSet set = { copyScalar, triadScalar, chainScalar };
+		#ifdef INFO_X86
+			switch ( isa)
+			{
+				case ilAvx512:
+				#ifdef INFO_AVX512
+				{
+					const KernelSet avx512 = { copyAvx512, triadAvx512, chainAvx512 };
+					return avx512;
+				}
+				#endif
+
+				case ilAvx2:
+				{
+					const KernelSet avx2 = { copyAvx2, triadAvx2, chainAvx2 };
+					return avx2;
+				}
+
+				case ilSse42:
+				{
+					const KernelSet sse = { copySse, triadSse, chainSse };
+					return sse;
+				}
+
+				default:
+					break;
+			}
+		#endif
+			return set;
+		}
+	}
+
+	IsaLevel detectIsa()
+	{
+	#ifdef INFO_X86
+		int info[ 4];
+		cpuid( info, 0, 0);
+		const int maxLeaf = info[ 0];
+
+		cpuid( info, 1, 0);
+		const int features = info[ 2];
+		if ( !( features & ( 1 << 20)))
+		{
+			return ilScalar;
+		}
+
+		// AVX state needs OSXSAVE and the OS saving XMM and YMM registers
+		const bool osAvx = ( features & ( 1 << 27)) && ( features & ( 1 << 28)) && ( enabledState() & 0x6) == 0x6;
+		if ( !osAvx || maxLeaf < 7 || !( features & ( 1 << 12)))
+		{
+			return ilSse42;
+		}
+
+		cpuid( info, 7, 0);
+		const int extended = info[ 1];
+		if ( !( extended & ( 1 << 5)))
+		{
+			return ilSse42;
+		}
+
+		// AVX-512 additionally needs the opmask and upper ZMM state
+		if ( ( extended & ( 1 << 16)) && ( enabledState() & 0xE6) == 0xE6)
+		{
+			return ilAvx512;
+		}
+
+		return ilAvx2;
+	#else
+		return ilScalar;
+	#endif
+	}
+
+	const char* isaName( const IsaLevel isa)
+	{
+		return isaNames[ isa];
+	}
+
+	const char* baselineKernelName( const BaselineKernel kernel)
+	{
+		return kernelNames[ kernel];
+	}
+
+	HostBaseline::HostBaseline( const size_t elements, const uint threadCount, const IsaLevel isa):
+		iElements( elements),
+		iIsa( isa),
+		iChainLength( 64),
+		iGeneration( 0),
+		iPending( 0),
+		iStopping( false)
+	{
+	#ifndef INFO_AVX512
+		iIsa = std::min( iIsa, ilAvx2);
+	#endif
+
+		// each buffer starts on a 64-byte boundary
+		const size_t padding = 16;
+		const size_t stride = ( elements + padding - 1) / padding * padding;
+		iStorage.resize( 3 * stride + padding);
+
+		auto base = &iStorage[ 0];
+		base += ( 64 - reinterpret_cast<size_t>( base) % 64) % 64 / sizeof(float);
+		for ( uint b = 0; b < 3; ++b)
+		{
+			iBuffers[ b] = base + b * stride;
+			std::fill( iBuffers[ b], iBuffers[ b] + elements, 1.0f);
+		}
+
+		const auto count = threadCount ? threadCount : std::max( std::thread::hardware_concurrency(), 1u);
+		for ( uint t = 1; t < count; ++t)
+		{
+			iThreads.push_back( std::thread( &HostBaseline::worker, this, t));
+		}
+	}
+
+	HostBaseline::~HostBaseline()
+	{
+		{
+			std::lock_guard<std::mutex> lock( iMutex);
+			iStopping = true;
+		}
+
+		iWake.notify_all();
+		for ( auto i = iThreads.begin(); i != iThreads.end(); ++i)
+		{
+			i->join();
+		}
+	}
+
+	void HostBaseline::parallel( const Work& work)
+	{
+		{
+			std::lock_guard<std::mutex> lock( iMutex);
+			iWork = work;
+			iPending = static_cast<uint>( iThreads.size());
+			++iGeneration;
+		}
+
+		iWake.notify_all();
+
+		const auto chunk = ( ( iElements + threadCount() - 1) / threadCount() + 63) / 64 * 64;
+		work( 0, std::min( chunk, iElements));
+
+		std::unique_lock<std::mutex> lock( iMutex);
+		iDone.wait( lock, [this] { return iPending == 0; });
+	}
+
+	void HostBaseline::worker( const uint index)
+	{
+		uint seen = 0;
+		for ( ;;)
+		{
+			{
+				std::unique_lock<std::mutex> lock( iMutex);
+				iWake.wait( lock, [&] { return iStopping || iGeneration != seen; });
+				if ( iStopping)
+				{
+					return;
+				}
+
+				seen = iGeneration;
+			}
+
+			// iWork stays untouched until every worker has reported back
+			const auto chunk = ( ( iElements + threadCount() - 1) / threadCount() + 63) / 64 * 64;
+			const auto begin = std::min( index * chunk, iElements);
+			iWork( begin, std::min( begin + chunk, iElements));
+
+			std::lock_guard<std::mutex> lock( iMutex);
+			if ( !--iPending)
+			{
+				iDone.notify_one();
+			}
+		}
+	}
+
+	void HostBaseline::describe( BaselineResult& result, const BaselineKernel kernel) const
+	{
+		const auto elements = static_cast<double>( iElements);
+		result.setKernel( kernel);
+		switch ( kernel)
+		{
+			case bkCopy:
+				result.setBytes( 2.0 * sizeof(float) * elements);
+				break;
+
+			case bkTriad:
+				result.setBytes( 3.0 * sizeof(float) * elements);
+				result.setFlops( 2.0 * elements);
+				break;
+
+			default:
+				result.setBytes( 2.0 * sizeof(float) * elements);
+				result.setFlops( 2.0 * iChainLength * elements);
+				break;
+		}
+	}
+
+	BaselineResult HostBaseline::run( const BaselineKernel kernel)
+	{
+		BaselineResult result;
+		describe( result, kernel);
+
+		const auto set = kernels( iIsa);
+		const auto a = buffer( 0);
+		const auto b = buffer( 1);
+		const auto c = buffer( 2);
+		const auto chain = iChainLength;
+
+		Work work;
+		switch ( kernel)
+		{
+			case bkCopy:
+				work = [=]( const size_t begin, const size_t end) { set.copy( a + begin, b + begin, end - begin); };
+				break;
+
+			case bkTriad:
+				work = [=]( const size_t begin, const size_t end) { set.triad( a + begin, b + begin, c + begin, triadScale, end - begin); };
+				break;
+
+			default:
+				work = [=]( const size_t begin, const size_t end) { set.chain( a + begin, end - begin, chain); };
+				break;
+		}
+
+		Benchmark benchmark;
+		benchmark.setSettings( iSettings);
+		result.setHost( benchmark.runHost( [&]() -> bool
+		{
+			parallel( work);
+			return true;
+		}));
+
+		return result;
+	}
+
+	void HostBaseline::compare( BaselineResultArray& results, const cl_context context, const cl_device_id id, const Device& device)
+	{
+		results.clear();
+
+		cl_int error = CL_SUCCESS;
+		const auto queue = clCreateCommandQueue( context, id, CL_QUEUE_PROFILING_ENABLE, &error);
+		check( error, "clCreateCommandQueue");
+
+		cl_program program = nullptr;
+		cl_mem buffers[ 3] = {};
+		cl_kernel kernel = nullptr;
+		try
+		{
+			const char* source = kernelSource;
+			const size_t sourceSize = strlen( source);
+			program = clCreateProgramWithSource( context, 1, &source, &sourceSize, &error);
+			check( error, "clCreateProgramWithSource");
+
+			error = clBuildProgram( program, 1, &id, "", nullptr, nullptr);
+			if ( error)
+			{
+				std::cerr << buildLog( program, id) << '\n';
+				check( error, "clBuildProgram");
+			}
+
+			const auto size = iElements * sizeof(float);
+			for ( uint b = 0; b < 3; ++b)
+			{
+				buffers[ b] = clCreateBuffer( context, CL_MEM_READ_WRITE, size, nullptr, &error);
+				check( error, "clCreateBuffer");
+
+				// initialized contents, and first touch and migration paid here rather than in the kernel timings
+				check( clEnqueueWriteBuffer( queue, buffers[ b], CL_TRUE, 0, size, buffer( b), 0, nullptr, nullptr), "clEnqueueWriteBuffer");
+			}
+
+			for ( int k = 0; k < baselineKernelCount; ++k)
+			{
+				const auto which = static_cast<BaselineKernel>( k);
+				auto result = run( which);
+
+				kernel = clCreateKernel( program, kernelNames[ k], &error);
+				check( error, "clCreateKernel");
+
+				// a is the output of every kernel; the chain updates it in place
+				uint inputs = 0;
+				cl_mem input[ 2];
+				float* source[ 2];
+				error = clSetKernelArg( kernel, 0, sizeof(cl_mem), &buffers[ 0]);
+				if ( which == bkFmaChain)
+				{
+					source[ inputs] = buffer( 0);
+					input[ inputs++] = buffers[ 0];
+					error |= clSetKernelArg( kernel, 1, sizeof(cl_uint), &iChainLength);
+				}
+				else
+				{
+					source[ inputs] = buffer( 1);
+					input[ inputs++] = buffers[ 1];
+					error |= clSetKernelArg( kernel, 1, sizeof(cl_mem), &buffers[ 1]);
+					if ( which == bkTriad)
+					{
+						source[ inputs] = buffer( 2);
+						input[ inputs++] = buffers[ 2];
+						error |= clSetKernelArg( kernel, 2, sizeof(cl_mem), &buffers[ 2]);
+						error |= clSetKernelArg( kernel, 3, sizeof(float), &triadScale);
+					}
+				}
+
+				check( error, "clSetKernelArg");
+
+				Benchmark benchmark( device.profilingTimerResolution());
+				benchmark.setSettings( iSettings);
+				const size_t global = iElements;
+				result.setDeviceKernel( benchmark.run( [&]() -> cl_event
+				{
+					cl_event event = nullptr;
+					return clEnqueueNDRangeKernel( queue, kernel, 1, nullptr, &global, nullptr, 0, nullptr, &event) ? nullptr : event;
+				}));
+
+				result.setDeviceTotal( benchmark.runHost( [&]() -> bool
+				{
+					cl_int status = CL_SUCCESS;
+					for ( uint i = 0; i < inputs; ++i)
+					{
+						status |= clEnqueueWriteBuffer( queue, input[ i], CL_FALSE, 0, size, source[ i], 0, nullptr, nullptr);
+					}
+
+					status |= clEnqueueNDRangeKernel( queue, kernel, 1, nullptr, &global, nullptr, 0, nullptr, nullptr);
+					status |= clEnqueueReadBuffer( queue, buffers[ 0], CL_TRUE, 0, size, buffer( 0), 0, nullptr, nullptr);
+					return status == CL_SUCCESS;
+				}));
+
+				clReleaseKernel( kernel);
+				kernel = nullptr;
+				results.push_back( result);
+			}
+		}
+		catch ( ...)
+		{
+			if ( kernel)
+			{
+				clReleaseKernel( kernel);
+			}
+
+			for ( uint b = 0; b < 3; ++b)
+			{
+				if ( buffers[ b])
+				{
+					clReleaseMemObject( buffers[ b]);
+				}
+			}
+
+			if ( program)
+			{
+				clReleaseProgram( program);
+			}
+
+			clReleaseCommandQueue( queue);
+			throw;
+		}
+
+		for ( uint b = 0; b < 3; ++b)
+		{
+			clReleaseMemObject( buffers[ b]);
+		}
+
+		clReleaseProgram( program);
+		clReleaseCommandQueue( queue);
+	}
+
+	void write( std::ostream& stream, const BaselineResultArray& results)
+	{
+		for ( auto i = results.begin(); i != results.end(); ++i)
+		{
+			const auto host = i->host().median();
+			const auto kernel = i->deviceKernel().median();
+			const auto total = i->deviceTotal().median();
+			stream << baselineKernelName( i->kernel()) << ": host " << host << " ns";
+			if ( host > 0.0)
+			{
+				stream << " (" << i->bytes() / host << " GB/s";
+				if ( i->flops() > 0.0)
+				{
+					stream << ", " << i->flops() / host << " GFLOP/s";
+				}
+
+				stream << ')';
+			}
+
+			if ( i->deviceTotal().isValid())
+			{
+				stream << ", device kernel " << kernel << " ns, with transfers " << total << " ns -> " << ( i->offload() ? "offload" : "host");
+			}
+
+			stream << '\n';
+		}
+	}
+}
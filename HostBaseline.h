@@ -0,0 +1,134 @@
+#pragma once
+#ifndef PCHDR
+	#include "Benchmark.h"
+	#include "OpenCLInfo.h"
+	#include <condition_variable>
+	#include <functional>
+	#include <mutex>
+	#include <ostream>
+	#include <thread>
+	#include <vector>
+#endif
+
+namespace Info
+{
+	enum IsaLevel
+	{
+		ilScalar,
+		ilSse42,
+		ilAvx2,			// with FMA3
+		ilAvx512		// AVX-512F
+	};
+
+	// highest level supported by both the CPU and the operating system (XSAVE state)
+	IsaLevel detectIsa();
+	const char* isaName( const IsaLevel isa);
+
+	enum BaselineKernel
+	{
+		bkCopy,			// a[i] = b[i]
+		bkTriad,		// a[i] = b[i] + s * c[i]
+		bkFmaChain,		// chainLength dependent fused multiply-adds per element
+		baselineKernelCount
+	};
+
+	const char* baselineKernelName( const BaselineKernel kernel);
+
+	class BaselineResult
+	{
+	public:
+		BaselineResult():
+			iBytes( 0.0),
+			iFlops( 0.0),
+			iKernel( bkCopy)
+		{}
+
+		BaselineKernel kernel() const { return iKernel; }
+		void setKernel( const BaselineKernel value) { iKernel = value; }
+
+		// memory traffic and arithmetic of one run
+		double bytes() const { return iBytes; }
+		void setBytes( const double value) { iBytes = value; }
+
+		double flops() const { return iFlops; }
+		void setFlops( const double value) { iFlops = value; }
+
+		const BenchmarkResult& host() const { return iHost; }
+		void setHost( const BenchmarkResult& item) { iHost = item; }
+
+		// the kernel alone, from profiling events
+		const BenchmarkResult& deviceKernel() const { return iDeviceKernel; }
+		void setDeviceKernel( const BenchmarkResult& item) { iDeviceKernel = item; }
+
+		// writing the inputs, launching and reading the output back, on the host clock
+		const BenchmarkResult& deviceTotal() const { return iDeviceTotal; }
+		void setDeviceTotal( const BenchmarkResult& item) { iDeviceTotal = item; }
+
+		// true only when the device wins including transfers and launch
+		bool offload() const { return iDeviceTotal.isValid() && iHost.isValid() && iDeviceTotal.median() < iHost.median(); }
+
+	private:
+		BenchmarkResult	iHost;
+		BenchmarkResult	iDeviceKernel;
+		BenchmarkResult	iDeviceTotal;
+		double			iBytes;
+		double			iFlops;
+		BaselineKernel	iKernel;
+	};
+
+	typedef std::vector<BaselineResult> BaselineResultArray;
+
+	// runs the baseline kernels as native SIMD loops on a pool of host threads
+	class HostBaseline
+	{
+	public:
+		// threadCount 0 uses every hardware thread
+		explicit HostBaseline( const size_t elements = 1 << 24, const uint threadCount = 0, const IsaLevel isa = detectIsa());
+		~HostBaseline();
+
+		IsaLevel isa() const { return iIsa; }
+		size_t elements() const { return iElements; }
+		uint threadCount() const { return static_cast<uint>( iThreads.size()) + 1; }
+
+		uint chainLength() const { return iChainLength; }
+		void setChainLength( const uint value) { iChainLength = value; }
+
+		const BenchmarkSettings& settings() const { return iSettings; }
+		void setSettings( const BenchmarkSettings& item) { iSettings = item; }
+
+		BaselineResult run( const BaselineKernel kernel);
+
+		// every kernel on the host and on the device, which should be the CPU device of the context
+		void compare( BaselineResultArray& results, const cl_context context, const cl_device_id id, const Device& device);
+
+	private:
+		HostBaseline( const HostBaseline&);
+		HostBaseline& operator=( const HostBaseline&);
+
+		typedef std::function<void ( const size_t begin, const size_t end)> Work;
+
+		// splits [0, elements) across the pool and the calling thread
+		void parallel( const Work& work);
+		void worker( const uint index);
+
+		float* buffer( const uint index) { return iBuffers[ index]; }
+		void describe( BaselineResult& result, const BaselineKernel kernel) const;
+
+		std::vector<float>			iStorage;
+		float*						iBuffers[ 3];
+		std::vector<std::thread>	iThreads;
+		std::mutex					iMutex;
+		std::condition_variable		iWake;
+		std::condition_variable		iDone;
+		Work						iWork;
+		BenchmarkSettings			iSettings;
+		size_t						iElements;
+		IsaLevel					iIsa;
+		uint						iChainLength;
+		uint						iGeneration;
+		uint						iPending;
+		bool						iStopping;
+	};
+
+	void write( std::ostream& stream, const BaselineResultArray& results);
+}
@@ -1,25 +1,24 @@
 #include "stdafx.h"
 #include "OpenCLInfo.h"
+#include "ConstantPlanner.h"
+#include "DeviceProbes.h"
+#include "Discovery.h"
+#include "FleetStore.h"
+#include "HostBaseline.h"
+#include "SharedSnapshot.h"
+#include "SnapshotDiff.h"
+#include "Serializer.h"
+#include "Watch.h"
+#include <chrono>
+#include <map>
+#include <sstream>
+#include <thread>
 
 namespace Info
 {
-	template <typename T>
-	T read( const cl_device_id deviceId, const uint field)
-	{
-		T item;
-		auto error = clGetDeviceInfo( deviceId, field, sizeof(T), &item, nullptr);
-		if (error)
-		{
-			std::cerr << "error = " << error << '\n';
-			throw Exception( field, error);
-		}
-
-		return item;
-	}
-
 	void readString( char* buffer, const size_t bufferSize, const cl_device_id deviceId, const uint field)
 	{
-		auto error = clGetDeviceInfo( deviceId, field, bufferSize, buffer, nullptr);
+		auto error = getDeviceInfo( deviceId, field, bufferSize, buffer, nullptr);
 		if (error)
 		{
 			std::cerr << "error = " << error << '\n';
@@ -87,21 +86,62 @@ namespace Info
 
 	void readExtensions( ExtensionArray& extensions, const cl_device_id id)
 	{
-		char buffer[ 1024];
-		readString( buffer, 1024, id, CL_DEVICE_EXTENSIONS);
-		for( char* p1 = buffer; ; )
+		// sized by the driver, since some lists run to several KB
+		size_t size = 0;
+		auto error = getDeviceInfo( id, CL_DEVICE_EXTENSIONS, 0, nullptr, &size);
+		if ( error)
 		{
-			char* p2 = strchr( p1, ' ');
-			if ( p2 && p1 != p2)
-			{
-				*p2 = 0;
-				extensions.push_back( p1);
-				p1 = p2 + 1;
-			}
-			else
+			throw Exception( CL_DEVICE_EXTENSIONS, error);
+		}
+
+		std::vector<char> buffer( size + 1);
+		readString( &buffer[ 0], buffer.size(), id, CL_DEVICE_EXTENSIONS);
+
+		// space separated, with or without a trailing space
+		const std::string text( &buffer[ 0]);
+		size_t start = 0;
+		while ( start < text.size())
+		{
+			auto stop = text.find( ' ', start);
+			stop = stop == std::string::npos ? text.size() : stop;
+			if ( stop != start)
 			{
-				break;
+				extensions.push_back( text.substr( start, stop - start));
 			}
+
+			start = stop + 1;
+		}
+	}
+
+	void readOpenClCFeatures( ExtensionArray& features, const cl_device_id id)
+	{
+		#ifndef CL_DEVICE_OPENCL_C_FEATURES
+			#define CL_DEVICE_OPENCL_C_FEATURES 0x106F
+		#endif
+
+		// cl_name_version, which older headers lack
+		struct NameVersion
+		{
+			cl_uint	version;
+			char	name[ 64];
+		};
+
+		// the query only exists from OpenCL 3.0 on, so a failure just means no features
+		size_t size = 0;
+		if ( getDeviceInfo( id, CL_DEVICE_OPENCL_C_FEATURES, 0, nullptr, &size) || size < sizeof(NameVersion))
+		{
+			return;
+		}
+
+		std::vector<NameVersion> items( size / sizeof(NameVersion));
+		if ( getDeviceInfo( id, CL_DEVICE_OPENCL_C_FEATURES, items.size() * sizeof(NameVersion), &items[ 0], nullptr))
+		{
+			return;
+		}
+
+		for ( auto i = items.begin(); i != items.end(); ++i)
+		{
+			features.push_back( std::string( i->name, strnlen( i->name, sizeof(i->name))));
 		}
 	}
 
@@ -127,13 +167,13 @@ namespace Info
 		memory.setSize( read<cl_ulong>( id, CL_DEVICE_GLOBAL_MEM_SIZE));
 	}
 
-	Image* readImageSupport( const cl_device_id id)
+	std::shared_ptr<Image> readImageSupport( const cl_device_id id)
 	{
-		Image* image = nullptr;
+		std::shared_ptr<Image> image;
 		const auto imageSupport = read<cl_bool>( id, CL_DEVICE_IMAGE_SUPPORT) != 0;
 		if ( imageSupport)
 		{
-			auto image = new Image();
+			image = std::make_shared<Image>();
 
 			{
 				Image2DMax img2D;
@@ -166,7 +206,7 @@ namespace Info
 	void readWorkItemSizes( Device::SizeTArray& sizeArray, const size_t maxWorkItemDimensions, const cl_device_id id)
 	{
 		auto sizes = new size_t[ maxWorkItemDimensions];
-		auto error = clGetDeviceInfo( id, CL_DEVICE_MAX_WORK_ITEM_SIZES, sizeof(size_t) * maxWorkItemDimensions, sizes, nullptr);
+		auto error = getDeviceInfo( id, CL_DEVICE_MAX_WORK_ITEM_SIZES, sizeof(size_t) * maxWorkItemDimensions, sizes, nullptr);
 		if (error)
 		{
 			std::cerr << "error = " << error << '\n';
@@ -177,7 +217,7 @@ namespace Info
 		delete [] sizes;
 	}
 
-	void readNativeVectorWidths( VectorWidthArray widths, const cl_device_id id)		
+	void readNativeVectorWidths( VectorWidthArray& widths, const cl_device_id id)		
 	{
 		widths.push_back( read<cl_uint>( id, CL_DEVICE_NATIVE_VECTOR_WIDTH_CHAR));
 		widths.push_back( read<cl_uint>( id, CL_DEVICE_NATIVE_VECTOR_WIDTH_SHORT));
@@ -188,7 +228,7 @@ namespace Info
 		widths.push_back( read<cl_uint>( id, CL_DEVICE_NATIVE_VECTOR_WIDTH_HALF));
 	}
 
-	void readPreferredVectorWidths( VectorWidthArray widths, const cl_device_id id)		
+	void readPreferredVectorWidths( VectorWidthArray& widths, const cl_device_id id)		
 	{
 		widths.push_back( read<cl_uint>( id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_CHAR));
 		widths.push_back( read<cl_uint>( id, CL_DEVICE_PREFERRED_VECTOR_WIDTH_SHORT));
@@ -235,7 +275,7 @@ namespace Info
 		{
 			cl_device_partition_property array[ 3];
 			{
-				auto error = clGetDeviceInfo( id, CL_DEVICE_PARTITION_PROPERTIES, sizeof(cl_device_partition_property) * 3, array, nullptr);
+				auto error = getDeviceInfo( id, CL_DEVICE_PARTITION_PROPERTIES, sizeof(cl_device_partition_property) * 3, array, nullptr);
 				if (error)
 				{
 					std::cerr << "error = " << error << '\n';
@@ -298,7 +338,7 @@ namespace Info
 	{
 		item.setAddressBits( read<cl_uint>( id, CL_DEVICE_ADDRESS_BITS));
 		item.setAvailable( read<cl_bool>( id, CL_DEVICE_AVAILABLE) != 0);
-		item.setCompilerAvailable( read<cl_bool>( id, CL_DEVICE_AVAILABLE) != 0);
+		item.setCompilerAvailable( read<cl_bool>( id, CL_DEVICE_COMPILER_AVAILABLE) != 0);
 		item.setLittleEndian( read<cl_bool>( id, CL_DEVICE_ENDIAN_LITTLE) != 0);
 		item.setErrorCorrectionSupport( read<cl_bool>( id, CL_DEVICE_ERROR_CORRECTION_SUPPORT) != 0);
 
@@ -359,10 +399,11 @@ namespace Info
 		item.setMaxConstantBufferSize( read<cl_ulong>( id, CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE));
 		item.setMaxMemoryAllocSize( read<cl_ulong>( id, CL_DEVICE_MAX_MEM_ALLOC_SIZE));
 		item.setMaxParameterSize( read<size_t>( id, CL_DEVICE_MAX_PARAMETER_SIZE));
-		item.setMaxReadImageArguments( read<size_t>( id, CL_DEVICE_MAX_READ_IMAGE_ARGS));
-		item.setMaxWriteImageArguments( read<size_t>( id, CL_DEVICE_MAX_WRITE_IMAGE_ARGS));
+		item.setMaxReadImageArguments( read<cl_uint>( id, CL_DEVICE_MAX_READ_IMAGE_ARGS));
+		item.setMaxWriteImageArguments( read<cl_uint>( id, CL_DEVICE_MAX_WRITE_IMAGE_ARGS));
 		item.setMaxSamplers( read<cl_uint>( id, CL_DEVICE_MAX_SAMPLERS));
 		item.setMaxWorkGroupSize( read<size_t>( id, CL_DEVICE_MAX_WORK_GROUP_SIZE));
+		item.setProfilingTimerResolution( read<size_t>( id, CL_DEVICE_PROFILING_TIMER_RESOLUTION));
 		item.setMaxWorkItemDimensions( read<cl_uint>( id, CL_DEVICE_MAX_WORK_ITEM_DIMENSIONS));
 
 		{
@@ -391,6 +432,15 @@ namespace Info
 
 			readString( buffer, 64, id, CL_DEVICE_PROFILE);
 			item.setProfile( buffer);
+
+			readString( buffer, 64, id, CL_DEVICE_OPENCL_C_VERSION);
+			item.setOpenClVersion( buffer);
+		}
+
+		{
+			ExtensionArray features;
+			readOpenClCFeatures( features, id);
+			item.setOpenClCFeatures( features);
 		}
 
 		{
@@ -410,7 +460,7 @@ namespace Info
 			item.setPartition( partition);
 		}
 
-		item.setPrintfBufferSize( read<cl_uint>( id, CL_DEVICE_PRINTF_BUFFER_SIZE));
+		item.setPrintfBufferSize( read<size_t>( id, CL_DEVICE_PRINTF_BUFFER_SIZE));
 		item.setPreferredInteropUserSync( read<cl_bool>( id, CL_DEVICE_PREFERRED_INTEROP_USER_SYNC) != 0);
 
 		{
@@ -431,7 +481,7 @@ namespace Info
 	cl_int read( Platform& info, const cl_platform_id platformId)
 	{
 		char buffer[ 128];
-		auto error = clGetPlatformInfo( platformId, CL_PLATFORM_VENDOR, 128, buffer, nullptr);
+		auto error = getPlatformInfo( platformId, CL_PLATFORM_VENDOR, 128, buffer, nullptr);
 		if ( !error)
 		{
 			info.setVendor( buffer);
@@ -439,7 +489,7 @@ namespace Info
 
 		if ( !error)
 		{
-			error = clGetPlatformInfo( platformId, CL_PLATFORM_NAME, 128, buffer, nullptr);
+			error = getPlatformInfo( platformId, CL_PLATFORM_NAME, 128, buffer, nullptr);
 			if ( !error)
 			{
 				info.setName( buffer);
@@ -448,7 +498,7 @@ namespace Info
 
 		if ( !error)
 		{
-			error = clGetPlatformInfo( platformId, CL_PLATFORM_VERSION, 128, buffer, nullptr);
+			error = getPlatformInfo( platformId, CL_PLATFORM_VERSION, 128, buffer, nullptr);
 			if ( !error)
 			{
 				info.setVersion( buffer);
@@ -505,8 +555,12 @@ int run()
 
 	{
 		using namespace Info;
-		Device device;
-		read( device, devices[ 0]);
+		DeviceRecordMap known;
+		DeviceInstanceArray instances( numDevices);
+		for ( cl_uint i = 0; i < numDevices; ++i)
+		{
+			read( instances[ i], devices[ i], dmDeduplicate, known);
+		}
 	}
 	
 	if (devices != nullptr)
@@ -518,20 +572,503 @@ int run()
 	return 0;
 }
 
+void writeTrace( const char* const path)
+{
+	using namespace Info;
+	Trace::RecordArray records;
+	Trace::collect( records);
+
+	{
+		std::ofstream file( path);
+		Trace::writeChromeTrace( file, records);
+	}
+
+	Trace::HistogramMap histograms;
+	Trace::histograms( histograms, records);
+	Trace::writeHistograms( std::cout, histograms);
+}
+
+class ConsoleWatchListener: public Info::WatchListener
+{
+public:
+	void changed( const Info::ChangeArray& changes)
+	{
+		Info::write( std::cout, changes);
+		std::cout.flush();
+	}
+};
+
+// devices that fail to read are skipped with a warning; false when nothing was found at all
+bool discoverAll( Info::PlatformRecordArray& platforms, const cl_device_type type)
+{
+	using namespace Info;
+	const auto error = discover( platforms, type, dmDeduplicate);
+	if ( error && platforms.empty())
+	{
+		std::cout << "Error: Getting platforms!" << std::endl;
+		return false;
+	}
+
+	if ( error)
+	{
+		std::cout << "Warning: Skipped a platform or device (" << error << ")!" << std::endl;
+	}
+
+	return true;
+}
+
+int watch( const unsigned int interval)
+{
+	using namespace Info;
+	PlatformRecordArray platforms;
+	if ( !discoverAll( platforms, CL_DEVICE_TYPE_ALL))
+	{
+		return 1;
+	}
+
+	DeviceInstanceArray devices;
+	for ( auto i = platforms.begin(); i != platforms.end(); ++i)
+	{
+		devices.insert( devices.end(), i->devices().begin(), i->devices().end());
+	}
+
+	ConsoleWatchListener listener;
+	Watch watch( devices, listener);
+	watch.setInterval( interval);
+	watch.start();
+	for ( ;;)
+	{
+		std::this_thread::sleep_for( std::chrono::hours( 1));
+	}
+}
+
+int publish( const char* const name, const unsigned int refresh)
+{
+	using namespace Info;
+	SharedSnapshotWriter writer( name);
+	if ( !writer.isOpen())
+	{
+		std::cout << "Error: Creating shared memory segment!" << std::endl;
+		return 1;
+	}
+
+	for ( ;;)
+	{
+		PlatformRecordArray platforms;
+		if ( discoverAll( platforms, CL_DEVICE_TYPE_ALL))
+		{
+			writer.publish( platforms);
+		}
+
+		std::this_thread::sleep_for( refresh ? std::chrono::seconds( refresh) : std::chrono::hours( 24 * 365));
+	}
+}
+
+int snapshot( const char* const jsonPath, const char* const binaryPath)
+{
+	using namespace Info;
+	PlatformRecordArray platforms;
+	if ( !discoverAll( platforms, CL_DEVICE_TYPE_ALL))
+	{
+		return 1;
+	}
+
+	if ( jsonPath)
+	{
+		std::ofstream file( jsonPath);
+		writeJson( file, platforms);
+	}
+
+	if ( binaryPath)
+	{
+		std::ofstream file( binaryPath, std::ios::binary);
+		writeBinary( file, platforms);
+	}
+
+	return 0;
+}
+
+int ingest( const char* const storePath, const std::vector<std::string>& snapshots)
+{
+	using namespace Info;
+	FleetStoreBuilder builder;
+	for ( auto i = snapshots.begin(); i != snapshots.end(); ++i)
+	{
+		// the node is named after the snapshot file
+		auto node = i->substr( i->find_last_of( "/\\") + 1);
+		node = node.substr( 0, node.rfind( '.'));
+
+		File::Mapping snapshot;
+		if ( !snapshot.open( *i) || !builder.add( node, snapshot.data(), snapshot.size()))
+		{
+			std::cout << "Error: Reading snapshot " << *i << "!" << std::endl;
+		}
+	}
+
+	if ( !builder.write( storePath))
+	{
+		std::cout << "Error: Writing fleet store!" << std::endl;
+		return 1;
+	}
+
+	std::cout << builder.rowCount() << " devices" << std::endl;
+	return 0;
+}
+
+int query( const char* const storePath, const char* const terms)
+{
+	using namespace Info;
+	FleetQuery query;
+	if ( !query.parse( terms))
+	{
+		std::cout << "Error: Invalid query!" << std::endl;
+		return 1;
+	}
+
+	FleetStore store;
+	if ( !store.open( storePath))
+	{
+		std::cout << "Error: Opening fleet store!" << std::endl;
+		return 1;
+	}
+
+	std::vector<uint> rows;
+	store.select( rows, query);
+	for ( auto i = rows.begin(); i != rows.end(); ++i)
+	{
+		std::cout << store.nodeName( store.node( *i)) << '\t' << store.deviceName( *i) << '\t' << store.driverVersion( *i) << '\n';
+	}
+
+	std::cout.flush();
+	return 0;
+}
+
+int diff( const char* const beforePath, const char* const afterPath, const char* const beforeProbes, const char* const afterProbes)
+{
+	using namespace Info;
+	SnapshotDiff diff;
+
+	{
+		File::Mapping before;
+		File::Mapping after;
+		if ( !before.open( beforePath) || !after.open( afterPath) || !diff.compare( before.data(), before.size(), after.data(), after.size()))
+		{
+			std::cout << "Error: Reading snapshots!" << std::endl;
+			return drInvalid;
+		}
+	}
+
+	if ( beforeProbes || afterProbes)
+	{
+		MeasurementArray before;
+		MeasurementArray after;
+		if ( !beforeProbes || !afterProbes || !loadMeasurements( before, beforeProbes) || !loadMeasurements( after, afterProbes))
+		{
+			std::cout << "Error: Reading measurements!" << std::endl;
+			return drInvalid;
+		}
+
+		diff.compare( before, after);
+	}
+
+	diff.rank();
+	write( std::cout, diff.differences());
+	std::cout.flush();
+	return diff.result();
+}
+
+// measurements for --probes-before and --probes-after, with devices named name#n as the diff does
+int probes( const char* const path)
+{
+	using namespace Info;
+	PlatformRecordArray platforms;
+	if ( !discoverAll( platforms, CL_DEVICE_TYPE_ALL))
+	{
+		return 1;
+	}
+
+	DeviceProbes probes;
+	MeasurementArray measurements;
+	std::map<std::string, uint> occurrences;
+	for ( auto i = platforms.begin(); i != platforms.end(); ++i)
+	{
+		for ( auto j = i->devices().begin(); j != i->devices().end(); ++j)
+		{
+			const auto& name = j->record()->name();
+			std::ostringstream key;
+			key << name << '#' << occurrences[ name]++;
+
+			const cl_context_properties properties[] = { CL_CONTEXT_PLATFORM, reinterpret_cast<cl_context_properties>( i->id()), 0 };
+			const auto id = j->id();
+			cl_int error = CL_SUCCESS;
+			const auto context = clCreateContext( properties, 1, &id, nullptr, nullptr, &error);
+			if ( error)
+			{
+				std::cout << "Error: Creating context for " << key.str() << "!" << std::endl;
+				continue;
+			}
+
+			try
+			{
+				probes.measure( measurements, context, id, *j->record(), key.str());
+			}
+			catch ( ApiException& ex)
+			{
+				std::cout << "Error: " << ex.function() << " failed on " << key.str() << "!" << std::endl;
+			}
+
+			clReleaseContext( context);
+		}
+	}
+
+	if ( !saveMeasurements( path, measurements))
+	{
+		std::cout << "Error: Writing measurements!" << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
+
+int baseline( const size_t elements)
+{
+	using namespace Info;
+	HostBaseline baseline( elements);
+	std::cout << "Host: " << isaName( baseline.isa()) << ", " << baseline.threadCount() << " threads" << std::endl;
+
+	// the host loops are only worth comparing with a CPU device sharing the same cores and memory
+	PlatformRecordArray platforms;
+	discoverAll( platforms, CL_DEVICE_TYPE_CPU);
+	for ( auto i = platforms.begin(); i != platforms.end(); ++i)
+	{
+		if ( i->devices().empty())
+		{
+			continue;
+		}
+
+		const auto& device = i->devices().front();
+		const cl_context_properties properties[] = { CL_CONTEXT_PLATFORM, reinterpret_cast<cl_context_properties>( i->id()), 0 };
+		const auto id = device.id();
+		cl_int error = CL_SUCCESS;
+		const auto context = clCreateContext( properties, 1, &id, nullptr, nullptr, &error);
+		if ( error)
+		{
+			std::cout << "Error: Creating context!" << std::endl;
+			return 1;
+		}
+
+		std::cout << "Device: " << device.record()->name() << std::endl;
+		BaselineResultArray results;
+		try
+		{
+			baseline.compare( results, context, id, *device.record());
+		}
+		catch ( ApiException& ex)
+		{
+			std::cout << "Error: " << ex.function() << " failed!" << std::endl;
+		}
+
+		clReleaseContext( context);
+		write( std::cout, results);
+		std::cout.flush();
+		return 0;
+	}
+
+	std::cout << "No CPU device, host only" << std::endl;
+	BaselineResultArray results;
+	for ( int k = 0; k < baselineKernelCount; ++k)
+	{
+		results.push_back( baseline.run( static_cast<BaselineKernel>( k)));
+	}
+
+	write( std::cout, results);
+	std::cout.flush();
+	return 0;
+}
+
+int constantPlan( const char* const text)
+{
+	using namespace Info;
+	ConstantCandidateArray candidates;
+	if ( !parseCandidates( candidates, text))
+	{
+		std::cout << "Error: Invalid constant candidates!" << std::endl;
+		return 1;
+	}
+
+	PlatformRecordArray platforms;
+	if ( !discoverAll( platforms, CL_DEVICE_TYPE_ALL))
+	{
+		return 1;
+	}
+
+	for ( auto i = platforms.begin(); i != platforms.end(); ++i)
+	{
+		for ( auto j = i->devices().begin(); j != i->devices().end(); ++j)
+		{
+			const ConstantPlanner planner( *j->record());
+			const auto plan = planner.plan( candidates);
+			std::cout << j->record()->name() << '\n';
+			write( std::cout, candidates, plan);
+			std::cout << ConstantPlanner::defines( candidates, plan) << "\n\n";
+		}
+	}
+
+	std::cout.flush();
+	return 0;
+}
+
 int main(int argc, char* argv[])
 {
+	const char* tracePath = nullptr;
+	const char* publishName = nullptr;
+	const char* jsonPath = nullptr;
+	const char* binaryPath = nullptr;
+	const char* storePath = nullptr;
+	const char* fleetQuery = nullptr;
+	std::vector<std::string> snapshots;
+	const char* diffBefore = nullptr;
+	const char* diffAfter = nullptr;
+	const char* probesBefore = nullptr;
+	const char* probesAfter = nullptr;
+	const char* probesOut = nullptr;
+	unsigned int watchInterval = 0;
+	unsigned int refresh = 0;
+	size_t baselineElements = 0;
+	const char* constantCandidates = nullptr;
+	for ( int i = 1; i + 1 < argc; ++i)
+	{
+		if ( !strcmp( argv[ i], "--trace"))
+		{
+			tracePath = argv[ ++i];
+		}
+		else if ( !strcmp( argv[ i], "--watch"))
+		{
+			watchInterval = static_cast<unsigned int>( atoi( argv[ ++i]));
+		}
+		else if ( !strcmp( argv[ i], "--publish"))
+		{
+			publishName = argv[ ++i];
+		}
+		else if ( !strcmp( argv[ i], "--refresh"))
+		{
+			refresh = static_cast<unsigned int>( atoi( argv[ ++i]));
+		}
+		else if ( !strcmp( argv[ i], "--json"))
+		{
+			jsonPath = argv[ ++i];
+		}
+		else if ( !strcmp( argv[ i], "--binary"))
+		{
+			binaryPath = argv[ ++i];
+		}
+		else if ( !strcmp( argv[ i], "--fleet-store"))
+		{
+			storePath = argv[ ++i];
+		}
+		else if ( !strcmp( argv[ i], "--fleet-ingest"))
+		{
+			snapshots.push_back( argv[ ++i]);
+		}
+		else if ( !strcmp( argv[ i], "--fleet-query"))
+		{
+			fleetQuery = argv[ ++i];
+		}
+		else if ( !strcmp( argv[ i], "--diff-before"))
+		{
+			diffBefore = argv[ ++i];
+		}
+		else if ( !strcmp( argv[ i], "--diff-after"))
+		{
+			diffAfter = argv[ ++i];
+		}
+		else if ( !strcmp( argv[ i], "--probes-before"))
+		{
+			probesBefore = argv[ ++i];
+		}
+		else if ( !strcmp( argv[ i], "--probes-after"))
+		{
+			probesAfter = argv[ ++i];
+		}
+		else if ( !strcmp( argv[ i], "--probes-out"))
+		{
+			probesOut = argv[ ++i];
+		}
+		else if ( !strcmp( argv[ i], "--baseline"))
+		{
+			baselineElements = static_cast<size_t>( strtoul( argv[ ++i], nullptr, 10));
+		}
+		else if ( !strcmp( argv[ i], "--constant-plan"))
+		{
+			constantCandidates = argv[ ++i];
+		}
+	}
+
+	int status = 0;
 	try
 	{
+		if ( diffBefore && diffAfter)
+		{
+			return diff( diffBefore, diffAfter, probesBefore, probesAfter);
+		}
+
+		if ( storePath && !snapshots.empty())
+		{
+			return ingest( storePath, snapshots);
+		}
+
+		if ( storePath && fleetQuery)
+		{
+			return query( storePath, fleetQuery);
+		}
+
+		if ( probesOut)
+		{
+			return probes( probesOut);
+		}
+
+		if ( constantCandidates)
+		{
+			return constantPlan( constantCandidates);
+		}
+
+		if ( baselineElements)
+		{
+			return baseline( baselineElements);
+		}
+
+		if ( jsonPath || binaryPath)
+		{
+			return snapshot( jsonPath, binaryPath);
+		}
+
+		if ( watchInterval)
+		{
+			return watch( watchInterval);
+		}
+
+		if ( publishName)
+		{
+			return publish( publishName, refresh);
+		}
+
+		Info::Trace::setEnabled( tracePath != nullptr);
 		run();
 	}
 	catch( std::exception& ex)
 	{
-		const char* c = ex.what();
-		c = 0;
+		std::cout << "Error: " << ex.what() << std::endl;
+		status = 1;
 	}
 	catch(...)
 	{
-		int x = 0;
+		status = 1;
 	}
-	return 0;
+
+	if ( tracePath)
+	{
+		writeTrace( tracePath);
+	}
+
+	return status;
 }
@@ -1,8 +1,11 @@
 #pragma once
 #ifndef PCHDR
 	#include <CL/cl.h>
+	#include <memory>
 	#include <vector>
 	#include <string>
+	#include <stdexcept>
+	#include <iostream>
 
 	typedef unsigned char       byte;
 	typedef short               int2;
@@ -17,18 +20,20 @@
 	typedef unsigned long long	ulong;
 #endif
 
+#include "Trace.h"
+
 namespace Info
 {
 	class Platform
 	{
 	public:
-		const std::string name() const { return iName; }
+		const std::string& name() const { return iName; }
 		void setName( const std::string& item) { iName = item; }
 
-		const std::string vendor() const { return iVendor; }
+		const std::string& vendor() const { return iVendor; }
 		void setVendor( const std::string& item) { iVendor = item; }
 
-		const std::string version() const { return iVersion; }
+		const std::string& version() const { return iVersion; }
 		void setVersion( const std::string& item) { iVersion = item; }
 
 	private:
@@ -67,7 +72,7 @@ namespace Info
 	class Memory
 	{
 	public:
-		ulong size() const { iSize; }
+		ulong size() const { return iSize; }
 		void setSize( const ulong value) { iSize = value; }
 
 	protected:
@@ -84,7 +89,7 @@ namespace Info
 			tReadWrite
 		};
 
-		Type type() const { iType; }
+		Type type() const { return iType; }
 		void setType( const Type value) { iType = value; }
 
 		uint lineSize() const { return iLineSize; }
@@ -114,7 +119,7 @@ namespace Info
 			tGlobal
 		};
 
-		Type type() const { iType; }
+		Type type() const { return iType; }
 		void setType( const Type value) { iType = value; }
 
 	private:
@@ -169,6 +174,17 @@ namespace Info
 
 	typedef std::vector<uint> VectorWidthArray;
 
+	enum VectorType
+	{
+		vtChar,
+		vtShort,
+		vtInt,
+		vtLong,
+		vtFloat,
+		vtDouble,
+		vtHalf
+	};
+
 	enum AffinityDomain
 	{
 		adNuma,
@@ -221,29 +237,29 @@ namespace Info
 	{
 	public:
 		Device():
-			iImage( nullptr)
+			iProfilingTimerResolution( 0)
 		{}
 
-		~Device()
-		{
-			delete iImage;
-		}
-
-		const std::string name() const { return iName; }
+		const std::string& name() const { return iName; }
 		void setName( const std::string& item) { iName = item; }
 
-		const std::string version() const { return iVersion; }
+		const std::string& version() const { return iVersion; }
 		void setVersion( const std::string& item) { iVersion = item; }
 
-		const std::string vendor() const { return iVendor; }
+		const std::string& vendor() const { return iVendor; }
 		void setVendor( const std::string& item) { iVendor = item; }
 
-		const std::string driverVersion() const { return iDriverVersion; }
+		const std::string& driverVersion() const { return iDriverVersion; }
 		void setDriverVersion( const std::string& item) { iDriverVersion = item; }
 
-		const std::string openClVersion() const { return iOpenClVersion; }
+		// CL_DEVICE_OPENCL_C_VERSION, "OpenCL C <major>.<minor> ..."
+		const std::string& openClVersion() const { return iOpenClVersion; }
 		void setOpenClVersion( const std::string& item) { iOpenClVersion = item; }
 
+		// feature macros such as __opencl_c_program_scope_global_variables; empty before OpenCL 3.0 and in snapshots
+		const ExtensionArray& openClCFeatures() const { return iOpenClCFeatures; }
+		void setOpenClCFeatures( const ExtensionArray& item) { iOpenClCFeatures = item; }
+
 		uint vendorId() const { return iVendorId; }
 		void setVendorId( const uint value) { iVendorId = value; }
 
@@ -298,8 +314,9 @@ namespace Info
 		const LocalMemory& localMemory() const { return iLocalMemory; }
 		void setLocalMemory( const LocalMemory& item) { iLocalMemory = item; }
 
-		const Image* image() const { return iImage; }
-		void setImage( const Image* const item) { iImage = item; }
+		// null without image support; shared by copies of the device
+		const Image* image() const { return iImage.get(); }
+		void setImage( const std::shared_ptr<const Image>& item) { iImage = item; }
 
 		uint maxClockFrequency() const { return iMaxClockFrequency; }
 		void setMaxClockFrequency( const uint value) { iMaxClockFrequency = value; }
@@ -345,7 +362,7 @@ namespace Info
 		uint minDataTypeAlignSize() const { return iMinDataTypeAlignSize; }
 		void setMinDataTypeAlignSize( const uint value) { iMinDataTypeAlignSize = value; }
 
-		const std::string profile() const { return iProfile; }
+		const std::string& profile() const { return iProfile; }
 		void setProfile( const std::string& item) { iProfile = item; }
 
 		size_t profilingTimerResolution() const { return iProfilingTimerResolution; }
@@ -375,6 +392,7 @@ namespace Info
 		FPCapabilityArray			iHalfFPCapabilities;
 		ExecutionCapabilityArray	iExecutionCapabilities;
 		ExtensionArray				iExtensions;
+		ExtensionArray				iOpenClCFeatures;
 		StringArray					iKernels;
 		GlobalMemory				iGlobalMemory;
 		LocalMemory					iLocalMemory;
@@ -390,7 +408,7 @@ namespace Info
 		std::string					iDriverVersion;
 		std::string					iProfile;
 		std::string					iOpenClVersion;
-		const Image*				iImage;
+		std::shared_ptr<const Image>	iImage;
 		ulong						iMaxConstantBufferSize;
 		ulong						iMaxMemoryAllocSize;
 		ulong						iMaxParameterSize;
@@ -435,6 +453,36 @@ namespace Info
 		int iError;
 	};
 
+	class ApiException: public std::runtime_error
+	{
+	public:
+		ApiException( const char* const function, const int error):
+			std::runtime_error( function),
+			iError( error)
+		{}
+
+		const char* function() const { return what(); }
+		int error() const { return iError; }
+
+	private:
+		int iError;
+	};
+
+	template <typename T>
+	T read( const cl_device_id deviceId, const uint field)
+	{
+		T item;
+		auto error = getDeviceInfo( deviceId, field, sizeof(T), &item, nullptr);
+		if (error)
+		{
+			std::cerr << "error = " << error << '\n';
+			throw Exception( field, error);
+		}
+
+		return item;
+	}
+
+	void readString( char* buffer, const size_t bufferSize, const cl_device_id deviceId, const uint field);
 	void read( Device& item, const cl_device_id id);
 	cl_int read( Platform& info, const cl_platform_id platformId);
 }
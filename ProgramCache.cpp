@@ -0,0 +1,292 @@
+#include "stdafx.h"
+#include "ProgramCache.h"
+#include "File.h"
+#include "Fingerprint.h"
+#include <algorithm>
+#include <sstream>
+
+namespace Info
+{
+	namespace
+	{
+		const char* const indexName = "index";
+	}
+
+	std::string buildLog( const cl_program program, const cl_device_id id)
+	{
+		size_t size = 0;
+		clGetProgramBuildInfo( program, id, CL_PROGRAM_BUILD_LOG, 0, nullptr, &size);
+		std::string log( size, '\0');
+		if ( size)
+		{
+			clGetProgramBuildInfo( program, id, CL_PROGRAM_BUILD_LOG, size, &log[ 0], nullptr);
+		}
+
+		return log;
+	}
+
+	bool programBinary( std::vector<char>& binary, const cl_program program)
+	{
+		size_t size = 0;
+		if ( clGetProgramInfo( program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t), &size, nullptr) || !size)
+		{
+			return false;
+		}
+
+		binary.resize( size);
+		unsigned char* pointer = reinterpret_cast<unsigned char*>( &binary[ 0]);
+		return clGetProgramInfo( program, CL_PROGRAM_BINARIES, sizeof(unsigned char*), &pointer, nullptr) == CL_SUCCESS;
+	}
+
+	ProgramCache::ProgramCache( const std::string& directory, const ulong maxSize):
+		iDirectory( directory),
+		iMaxSize( maxSize),
+		iSize( 0),
+		iTick( 0),
+		iDirty( false)
+	{
+		File::makeDirectory( iDirectory);
+		mergeIndex();
+	}
+
+	ProgramCache::~ProgramCache()
+	{
+		std::lock_guard<std::mutex> lock( iMutex);
+		if ( iDirty)
+		{
+			mergeIndex();
+			saveIndex();
+		}
+	}
+
+	std::string ProgramCache::key( const Device& device, const std::string& source, const std::string& options)
+	{
+		Hash hash;
+		hash.add( fingerprint( device)).add( options).add( source);
+		return hash.text();
+	}
+
+	ulong ProgramCache::size() const
+	{
+		std::lock_guard<std::mutex> lock( iMutex);
+		return iSize;
+	}
+
+	std::string ProgramCache::path( const std::string& key) const
+	{
+		return File::join( iDirectory, key + ".bin");
+	}
+
+	void ProgramCache::mergeIndex()
+	{
+		{
+			std::ifstream file( File::join( iDirectory, indexName).c_str());
+			std::string key;
+			ulong size, lastUse;
+			while ( file >> key >> size >> lastUse)
+			{
+				auto i = iEntries.find( key);
+				if ( i == iEntries.end())
+				{
+					i = iEntries.insert( EntryMap::value_type( key, Entry())).first;
+					i->second.setSize( size);
+				}
+
+				i->second.setLastUse( std::max( i->second.lastUse(), lastUse));
+				iTick = std::max( iTick, lastUse);
+			}
+		}
+
+		// another process may have evicted or replaced a binary since
+		iSize = 0;
+		for ( auto i = iEntries.begin(); i != iEntries.end(); )
+		{
+			ulong size;
+			if ( !File::size( size, path( i->first)) || size != i->second.size())
+			{
+				i = iEntries.erase( i);
+			}
+			else
+			{
+				iSize += size;
+				++i;
+			}
+		}
+	}
+
+	void ProgramCache::saveIndex() const
+	{
+		std::ostringstream stream;
+		for ( auto i = iEntries.begin(); i != iEntries.end(); ++i)
+		{
+			stream << i->first << ' ' << i->second.size() << ' ' << i->second.lastUse() << '\n';
+		}
+
+		const auto text = stream.str();
+		File::writeAtomically( File::join( iDirectory, indexName), text.data(), text.size());
+	}
+
+	void ProgramCache::evict()
+	{
+		while ( iSize > iMaxSize && !iEntries.empty())
+		{
+			auto oldest = iEntries.begin();
+			for ( auto i = iEntries.begin(); i != iEntries.end(); ++i)
+			{
+				if ( i->second.lastUse() < oldest->second.lastUse())
+				{
+					oldest = i;
+				}
+			}
+
+			File::remove( path( oldest->first));
+			iSize -= oldest->second.size();
+			iEntries.erase( oldest);
+		}
+	}
+
+	bool ProgramCache::find( const std::string& key, std::vector<char>& binary)
+	{
+		std::lock_guard<std::mutex> lock( iMutex);
+		auto i = iEntries.find( key);
+		if ( i == iEntries.end())
+		{
+			return false;
+		}
+
+		if ( !File::read( binary, path( key)) || binary.size() != i->second.size())
+		{
+			iSize -= i->second.size();
+			iEntries.erase( i);
+			return false;
+		}
+
+		// written on the next store or remove, or at destruction
+		i->second.setLastUse( ++iTick);
+		iDirty = true;
+		return true;
+	}
+
+	void ProgramCache::store( const std::string& key, const std::vector<char>& binary)
+	{
+		if ( binary.empty() || binary.size() > iMaxSize)
+		{
+			return;
+		}
+
+		std::lock_guard<std::mutex> lock( iMutex);
+		if ( !File::writeAtomically( path( key), &binary[ 0], binary.size()))
+		{
+			return;
+		}
+
+		auto& entry = iEntries[ key];
+		iSize -= entry.size();
+		entry.setSize( binary.size());
+		entry.setLastUse( ++iTick);
+		iSize += entry.size();
+
+		mergeIndex();
+		evict();
+		saveIndex();
+		iDirty = false;
+	}
+
+	void ProgramCache::remove( const std::string& key)
+	{
+		std::lock_guard<std::mutex> lock( iMutex);
+		auto i = iEntries.find( key);
+		if ( i != iEntries.end())
+		{
+			File::remove( path( key));
+			iSize -= i->second.size();
+			iEntries.erase( i);
+			mergeIndex();
+			saveIndex();
+			iDirty = false;
+		}
+	}
+
+	cl_program ProgramCache::build( const cl_context context, const cl_device_id id, const Device& device, const std::string& source, const std::string& options, bool* const hit, std::string* const log)
+	{
+		const auto programKey = key( device, source, options);
+		if ( hit)
+		{
+			*hit = false;
+		}
+
+		{
+			std::vector<char> binary;
+			if ( find( programKey, binary))
+			{
+				const size_t size = binary.size();
+				const unsigned char* pointer = reinterpret_cast<const unsigned char*>( &binary[ 0]);
+				cl_int binaryStatus = CL_SUCCESS;
+				cl_int error = CL_SUCCESS;
+				auto program = clCreateProgramWithBinary( context, 1, &id, &size, &pointer, &binaryStatus, &error);
+				if ( !error && !binaryStatus)
+				{
+					error = clBuildProgram( program, 1, &id, options.c_str(), nullptr, nullptr);
+				}
+
+				if ( !error && !binaryStatus)
+				{
+					if ( hit)
+					{
+						*hit = true;
+					}
+
+					return program;
+				}
+
+				// stale or rejected binary; fall back to the source
+				if ( program)
+				{
+					clReleaseProgram( program);
+				}
+
+				remove( programKey);
+			}
+		}
+
+		cl_int error = CL_SUCCESS;
+		const char* text = source.c_str();
+		const size_t textSize = source.size();
+		auto program = clCreateProgramWithSource( context, 1, &text, &textSize, &error);
+		if ( error)
+		{
+			throw ApiException( "clCreateProgramWithSource", error);
+		}
+
+		error = clBuildProgram( program, 1, &id, options.c_str(), nullptr, nullptr);
+		if ( log || error)
+		{
+			const auto text = buildLog( program, id);
+			if ( log)
+			{
+				*log = text;
+			}
+
+			if ( error)
+			{
+				std::cerr << text << '\n';
+			}
+		}
+
+		if ( error)
+		{
+			clReleaseProgram( program);
+			throw ApiException( "clBuildProgram", error);
+		}
+
+		{
+			std::vector<char> binary;
+			if ( programBinary( binary, program))
+			{
+				store( programKey, binary);
+			}
+		}
+
+		return program;
+	}
+}
@@ -0,0 +1,74 @@
+#pragma once
+#ifndef PCHDR
+	#include "OpenCLInfo.h"
+	#include <map>
+	#include <mutex>
+	#include <string>
+	#include <vector>
+#endif
+
+namespace Info
+{
+	class ProgramCache
+	{
+	public:
+		// the index is shared with other processes using the same directory and merged before every write
+		ProgramCache( const std::string& directory, const ulong maxSize);
+		~ProgramCache();
+
+		// builds from the cached binary on a hit; compiles the source and stores its binary on a miss
+		cl_program build( const cl_context context, const cl_device_id id, const Device& device, const std::string& source, const std::string& options, bool* const hit = nullptr, std::string* const log = nullptr);
+
+		bool find( const std::string& key, std::vector<char>& binary);
+		void store( const std::string& key, const std::vector<char>& binary);
+		void remove( const std::string& key);
+
+		const std::string& directory() const { return iDirectory; }
+		ulong maxSize() const { return iMaxSize; }
+		ulong size() const;
+
+		static std::string key( const Device& device, const std::string& source, const std::string& options);
+
+	private:
+		ProgramCache( const ProgramCache&);
+		ProgramCache& operator=( const ProgramCache&);
+
+		class Entry
+		{
+		public:
+			Entry():
+				iSize( 0),
+				iLastUse( 0)
+			{}
+
+			ulong size() const { return iSize; }
+			void setSize( const ulong value) { iSize = value; }
+
+			ulong lastUse() const { return iLastUse; }
+			void setLastUse( const ulong value) { iLastUse = value; }
+
+		private:
+			ulong iSize;
+			ulong iLastUse;
+		};
+
+		typedef std::map<std::string, Entry> EntryMap;
+
+		// adds the entries of the on-disk index and drops entries whose binary is gone or has another size
+		void mergeIndex();
+		void saveIndex() const;
+		void evict();
+		std::string path( const std::string& key) const;
+
+		mutable std::mutex	iMutex;
+		EntryMap			iEntries;
+		std::string			iDirectory;
+		ulong				iMaxSize;
+		ulong				iSize;
+		ulong				iTick;
+		bool				iDirty;		// recency changed since the last save
+	};
+
+	std::string buildLog( const cl_program program, const cl_device_id id);
+	bool programBinary( std::vector<char>& binary, const cl_program program);
+}
@@ -0,0 +1,812 @@
+#include "stdafx.h"
+#include "Serializer.h"
+#include <cstring>
+
+namespace Info
+{
+	namespace
+	{
+		const char* const fpCapabilityNames[] = { "denorm", "infNan", "roundToNearest", "roundToZero", "roundToInf", "fma", "correctlyRoundedDivideSqrt", "softFloat" };
+		const char* const executionCapabilityNames[] = { "kernel", "nativeKernel" };
+		const char* const affinityDomainNames[] = { "numa", "l4Cache", "l3Cache", "l2Cache", "l1Cache" };
+		const char* const queuePropertyNames[] = { "outOfOrder", "profiling" };
+		const char* const deviceTypeNames[] = { "default", "cpu", "gpu", "accelerator", "custom" };
+		const char* const cacheTypeNames[] = { "none", "readOnly", "readWrite" };
+		const char* const localMemoryTypeNames[] = { "local", "global" };
+		const char* const vectorTypeNames[] = { "char", "short", "int", "long", "float", "double", "half" };
+
+		static_assert( sizeof(Binary::Header) % 8 == 0, "binary header must keep records aligned");
+		static_assert( sizeof(Binary::PlatformBlock) % 8 == 0, "platform block must keep strings aligned");
+		static_assert( sizeof(Binary::DeviceBlock) % 8 == 0, "device block must keep strings aligned");
+
+		template <typename T, size_t N>
+		void writeNames( JsonWriter& writer, const std::vector<T>& items, const char* const ( &names)[ N])
+		{
+			writer.beginArray();
+			for ( auto i = items.begin(); i != items.end(); ++i)
+			{
+				if ( static_cast<size_t>( *i) < N)
+				{
+					writer.value( names[ *i]);
+				}
+			}
+
+			writer.endArray();
+		}
+
+		template <typename T>
+		uint mask( const std::vector<T>& items)
+		{
+			uint result = 0;
+			for ( auto i = items.begin(); i != items.end(); ++i)
+			{
+				result |= 1u << *i;
+			}
+
+			return result;
+		}
+
+		template <typename T>
+		void unmask( std::vector<T>& items, const uint value)
+		{
+			items.clear();
+			for ( uint bit = 0; bit < 32; ++bit)
+			{
+				if ( value & ( 1u << bit))
+				{
+					items.push_back( static_cast<T>( bit));
+				}
+			}
+		}
+
+		void writeWidths( JsonWriter& writer, const VectorWidthArray& widths)
+		{
+			writer.beginObject();
+			for ( size_t w = 0; w < widths.size() && w < sizeof(vectorTypeNames) / sizeof(vectorTypeNames[ 0]); ++w)
+			{
+				writer.key( vectorTypeNames[ w]).value( widths[ w]);
+			}
+
+			writer.endObject();
+		}
+
+		void writeJson( JsonWriter& writer, const DeviceInstance& instance)
+		{
+			writer.beginObject();
+			writer.key( "available").value( instance.isAvailable());
+			writer.key( "shared").value( instance.isShared());
+
+			const auto& pci = instance.pciLocation();
+			if ( pci.isValid())
+			{
+				writer.key( "pci").beginObject();
+				writer.key( "domain").value( pci.domain());
+				writer.key( "bus").value( pci.bus());
+				writer.key( "device").value( pci.device());
+				writer.key( "function").value( pci.function());
+				writer.endObject();
+			}
+
+			if ( !instance.record())
+			{
+				writer.endObject();
+				return;
+			}
+
+			const auto& device = *instance.record();
+			writer.key( "name").value( device.name());
+			writer.key( "vendor").value( device.vendor());
+			writer.key( "vendorId").value( device.vendorId());
+			writer.key( "version").value( device.version());
+			writer.key( "driverVersion").value( device.driverVersion());
+			writer.key( "openClVersion").value( device.openClVersion());
+			writer.key( "profile").value( device.profile());
+			writer.key( "type");
+			writeNames( writer, device.type(), deviceTypeNames);
+
+			writer.key( "compilerAvailable").value( device.isCompilerAvailable());
+			writer.key( "linkerAvailable").value( device.isLinkerAvailable());
+			writer.key( "littleEndian").value( device.isLittleEndian());
+			writer.key( "hostUnifiedMemory").value( device.hasHostUnifiedMemory());
+			writer.key( "errorCorrectionSupport").value( device.hasErrorCorrectionSupport());
+			writer.key( "preferredInteropUserSync").value( device.preferredInteropUserSync());
+			writer.key( "addressBits").value( device.addressBits());
+			writer.key( "maxClockFrequency").value( device.maxClockFrequency());
+			writer.key( "maxComputeUnits").value( device.maxComputeUnits());
+			writer.key( "maxConstantArgs").value( device.maxConstantArgs());
+			writer.key( "maxConstantBufferSize").value( device.maxConstantBufferSize());
+			writer.key( "maxMemoryAllocSize").value( device.maxMemoryAllocSize());
+			writer.key( "maxParameterSize").value( device.maxParameterSize());
+			writer.key( "maxReadImageArguments").value( device.maxReadImageArguments());
+			writer.key( "maxWriteImageArguments").value( device.maxWriteImageArguments());
+			writer.key( "maxSamplers").value( device.maxSamplers());
+			writer.key( "maxWorkGroupSize").value( static_cast<ulong>( device.maxWorkGroupSize()));
+			writer.key( "maxWorkItemDimensions").value( device.maxWorkItemDimensions());
+
+			writer.key( "maxWorkItemSizes").beginArray();
+			for ( auto i = device.maxWorkItemSizes().begin(); i != device.maxWorkItemSizes().end(); ++i)
+			{
+				writer.value( static_cast<ulong>( *i));
+			}
+
+			writer.endArray();
+			writer.key( "memoryBaseAddressAlignment").value( device.memoryBaseAddressAlignment());
+			writer.key( "minDataTypeAlignSize").value( device.minDataTypeAlignSize());
+			writer.key( "profilingTimerResolution").value( static_cast<ulong>( device.profilingTimerResolution()));
+			writer.key( "printfBufferSize").value( static_cast<ulong>( device.printfBufferSize()));
+			writer.key( "referenceCount").value( device.referenceCount());
+
+			{
+				const auto& memory = device.globalMemory();
+				writer.key( "globalMemory").beginObject();
+				writer.key( "size").value( memory.size());
+				writer.key( "cache").beginObject();
+				writer.key( "type").value( cacheTypeNames[ memory.cache().type()]);
+				writer.key( "size").value( memory.cache().size());
+				writer.key( "lineSize").value( memory.cache().lineSize());
+				writer.endObject();
+				writer.endObject();
+			}
+
+			writer.key( "localMemory").beginObject();
+			writer.key( "type").value( localMemoryTypeNames[ device.localMemory().type()]);
+			writer.key( "size").value( device.localMemory().size());
+			writer.endObject();
+
+			if ( device.image())
+			{
+				const auto& image = *device.image();
+				writer.key( "image").beginObject();
+				writer.key( "max2D").beginObject();
+				writer.key( "width").value( static_cast<ulong>( image.max2D().width()));
+				writer.key( "height").value( static_cast<ulong>( image.max2D().height()));
+				writer.endObject();
+				writer.key( "max3D").beginObject();
+				writer.key( "width").value( static_cast<ulong>( image.max3D().width()));
+				writer.key( "height").value( static_cast<ulong>( image.max3D().height()));
+				writer.key( "depth").value( static_cast<ulong>( image.max3D().depth()));
+				writer.endObject();
+				writer.key( "maxBufferSize").value( static_cast<ulong>( image.maxBufferSize()));
+				writer.key( "maxArraySize").value( static_cast<ulong>( image.maxArraySize()));
+				writer.endObject();
+			}
+
+			writer.key( "nativeVectorWidths");
+			writeWidths( writer, device.nativeVectorWidths());
+			writer.key( "preferredVectorWidths");
+			writeWidths( writer, device.preferredVectorWidths());
+
+			writer.key( "singleFpCapabilities");
+			writeNames( writer, device.singleFpCapabilities(), fpCapabilityNames);
+			writer.key( "doubleFpCapabilities");
+			writeNames( writer, device.doubleFpCapabilities(), fpCapabilityNames);
+			writer.key( "halfFpCapabilities");
+			writeNames( writer, device.halfFpCapabilities(), fpCapabilityNames);
+			writer.key( "executionCapabilities");
+			writeNames( writer, device.executionCapabilities(), executionCapabilityNames);
+			writer.key( "queueProperties");
+			writeNames( writer, device.queueProperties(), queuePropertyNames);
+
+			writer.key( "partition").beginObject();
+			writer.key( "maxSubDevices").value( device.partition().maxSubDevices());
+			writer.key( "affinityDomains");
+			writeNames( writer, device.partition().affinityDomains(), affinityDomainNames);
+			writer.endObject();
+
+			writer.key( "extensions").beginArray();
+			for ( auto i = device.extensions().begin(); i != device.extensions().end(); ++i)
+			{
+				writer.value( *i);
+			}
+
+			writer.endArray();
+			writer.endObject();
+		}
+
+		const char padding[ 8] = {};
+
+		size_t padded( const size_t size)
+		{
+			return ( size + 7) & ~static_cast<size_t>( 7);
+		}
+
+		size_t extensionsSize( const ExtensionArray& extensions)
+		{
+			size_t size = 0;
+			for ( auto i = extensions.begin(); i != extensions.end(); ++i)
+			{
+				size += i->size() + ( size ? 1 : 0);
+			}
+
+			return size;
+		}
+
+		void writeLength( std::ostream& stream, const size_t size)
+		{
+			const uint length = static_cast<uint>( size);
+			stream.write( reinterpret_cast<const char*>( &length), sizeof(length));
+		}
+
+		void writeString( std::ostream& stream, const std::string& item)
+		{
+			writeLength( stream, item.size());
+			stream.write( item.data(), item.size());
+		}
+
+		void writePadding( std::ostream& stream, const size_t size)
+		{
+			stream.write( padding, padded( size) - size);
+		}
+
+		void writeBinary( std::ostream& stream, const Platform& platform, const uint deviceCount)
+		{
+			const size_t strings =
+				3 * sizeof(uint) + platform.name().size() + platform.vendor().size() + platform.version().size();
+
+			Binary::PlatformBlock block;
+			block.size = static_cast<uint>( sizeof(block) + padded( strings));
+			block.deviceCount = deviceCount;
+			stream.write( reinterpret_cast<const char*>( &block), sizeof(block));
+
+			writeString( stream, platform.name());
+			writeString( stream, platform.vendor());
+			writeString( stream, platform.version());
+			writePadding( stream, strings);
+		}
+
+		void fill( Binary::DeviceBlock& block, const DeviceInstance& instance, const Device& device)
+		{
+			memset( &block, 0, sizeof(block));
+			block.flags = flags( instance);
+			block.globalMemorySize = device.globalMemory().size();
+			block.globalCacheSize = device.globalMemory().cache().size();
+			block.localMemorySize = device.localMemory().size();
+			block.maxMemoryAllocSize = device.maxMemoryAllocSize();
+			block.maxConstantBufferSize = device.maxConstantBufferSize();
+			block.maxParameterSize = device.maxParameterSize();
+			block.maxWorkGroupSize = device.maxWorkGroupSize();
+			for ( size_t d = 0; d < 3 && d < device.maxWorkItemSizes().size(); ++d)
+			{
+				block.maxWorkItemSizes[ d] = device.maxWorkItemSizes()[ d];
+			}
+
+			block.profilingTimerResolution = device.profilingTimerResolution();
+			block.printfBufferSize = device.printfBufferSize();
+			if ( device.image())
+			{
+				const auto& image = *device.image();
+				block.image2DMax[ 0] = image.max2D().width();
+				block.image2DMax[ 1] = image.max2D().height();
+				block.image3DMax[ 0] = image.max3D().width();
+				block.image3DMax[ 1] = image.max3D().height();
+				block.image3DMax[ 2] = image.max3D().depth();
+				block.imageMaxBufferSize = image.maxBufferSize();
+				block.imageMaxArraySize = image.maxArraySize();
+			}
+
+			for ( size_t w = 0; w < 7; ++w)
+			{
+				block.nativeVectorWidths[ w] = w < device.nativeVectorWidths().size() ? device.nativeVectorWidths()[ w] : 0;
+				block.preferredVectorWidths[ w] = w < device.preferredVectorWidths().size() ? device.preferredVectorWidths()[ w] : 0;
+			}
+
+			block.vendorId = device.vendorId();
+			block.maxComputeUnits = device.maxComputeUnits();
+			block.maxClockFrequency = device.maxClockFrequency();
+			block.maxConstantArgs = device.maxConstantArgs();
+			block.maxReadImageArguments = device.maxReadImageArguments();
+			block.maxWriteImageArguments = device.maxWriteImageArguments();
+			block.maxSamplers = device.maxSamplers();
+			block.maxWorkItemDimensions = device.maxWorkItemDimensions();
+			block.addressBits = device.addressBits();
+			block.memoryBaseAddressAlignment = device.memoryBaseAddressAlignment();
+			block.minDataTypeAlignSize = device.minDataTypeAlignSize();
+			block.globalCacheLineSize = device.globalMemory().cache().lineSize();
+			block.globalCacheType = device.globalMemory().cache().type();
+			block.localMemoryType = device.localMemory().type();
+			block.referenceCount = device.referenceCount();
+			block.partitionMaxSubDevices = device.partition().maxSubDevices();
+			block.typeMask = mask( device.type());
+			block.singleFpMask = mask( device.singleFpCapabilities());
+			block.doubleFpMask = mask( device.doubleFpCapabilities());
+			block.halfFpMask = mask( device.halfFpCapabilities());
+			block.executionMask = mask( device.executionCapabilities());
+			block.queueMask = mask( device.queueProperties());
+			block.affinityDomainMask = mask( device.partition().affinityDomains());
+
+			const auto& pci = instance.pciLocation();
+			if ( pci.isValid())
+			{
+				block.pciDomain = pci.domain();
+				block.pciBus = pci.bus();
+				block.pciDevice = pci.device();
+				block.pciFunction = pci.function();
+			}
+		}
+
+		void writeBinary( std::ostream& stream, const DeviceInstance& instance)
+		{
+			static const Device empty;
+			const auto& device = instance.record() ? *instance.record() : empty;
+			const auto extensions = extensionsSize( device.extensions());
+			const size_t strings = Binary::deviceStringCount * sizeof(uint) +
+				device.name().size() + device.vendor().size() + device.version().size() + device.driverVersion().size() +
+				device.openClVersion().size() + device.profile().size() + extensions;
+
+			Binary::DeviceBlock block;
+			fill( block, instance, device);
+			block.size = static_cast<uint>( sizeof(block) + padded( strings));
+			stream.write( reinterpret_cast<const char*>( &block), sizeof(block));
+
+			writeString( stream, device.name());
+			writeString( stream, device.vendor());
+			writeString( stream, device.version());
+			writeString( stream, device.driverVersion());
+			writeString( stream, device.openClVersion());
+			writeString( stream, device.profile());
+
+			writeLength( stream, extensions);
+			for ( auto i = device.extensions().begin(); i != device.extensions().end(); ++i)
+			{
+				if ( i != device.extensions().begin())
+				{
+					stream.put( ' ');
+				}
+
+				stream.write( i->data(), i->size());
+			}
+
+			writePadding( stream, strings);
+		}
+	}
+
+	JsonWriter::JsonWriter( std::ostream& stream):
+		iStream( stream),
+		iDepth( 0),
+		iAfterKey( false)
+	{
+		iFirst[ 0] = true;
+	}
+
+	void JsonWriter::separate()
+	{
+		if ( iAfterKey)
+		{
+			iAfterKey = false;
+			return;
+		}
+
+		if ( !iFirst[ iDepth])
+		{
+			iStream.put( ',');
+		}
+
+		iFirst[ iDepth] = false;
+	}
+
+	JsonWriter& JsonWriter::beginObject()
+	{
+		separate();
+		iStream.put( '{');
+		if ( iDepth + 1 < maxDepth)
+		{
+			iFirst[ ++iDepth] = true;
+		}
+
+		return *this;
+	}
+
+	JsonWriter& JsonWriter::endObject()
+	{
+		iStream.put( '}');
+		iDepth = iDepth > 0 ? iDepth - 1 : 0;
+		return *this;
+	}
+
+	JsonWriter& JsonWriter::beginArray()
+	{
+		separate();
+		iStream.put( '[');
+		if ( iDepth + 1 < maxDepth)
+		{
+			iFirst[ ++iDepth] = true;
+		}
+
+		return *this;
+	}
+
+	JsonWriter& JsonWriter::endArray()
+	{
+		iStream.put( ']');
+		iDepth = iDepth > 0 ? iDepth - 1 : 0;
+		return *this;
+	}
+
+	JsonWriter& JsonWriter::key( const char* const name)
+	{
+		separate();
+		string( name, strlen( name));
+		iStream.put( ':');
+		iAfterKey = true;
+		return *this;
+	}
+
+	JsonWriter& JsonWriter::value( const std::string& item)
+	{
+		separate();
+		string( item.data(), item.size());
+		return *this;
+	}
+
+	JsonWriter& JsonWriter::value( const char* const item)
+	{
+		separate();
+		string( item, strlen( item));
+		return *this;
+	}
+
+	JsonWriter& JsonWriter::value( const uint item)
+	{
+		separate();
+		iStream << item;
+		return *this;
+	}
+
+	JsonWriter& JsonWriter::value( const ulong item)
+	{
+		separate();
+		iStream << item;
+		return *this;
+	}
+
+	JsonWriter& JsonWriter::value( const bool item)
+	{
+		separate();
+		iStream << ( item ? "true" : "false");
+		return *this;
+	}
+
+	void JsonWriter::string( const char* const data, const size_t size)
+	{
+		static const char hex[] = "0123456789abcdef";
+
+		iStream.put( '"');
+		size_t start = 0;
+		for ( size_t i = 0; i < size; ++i)
+		{
+			const auto c = static_cast<unsigned char>( data[ i]);
+			if ( c >= 0x20 && c != '"' && c != '\\')
+			{
+				continue;
+			}
+
+			iStream.write( data + start, i - start);
+			start = i + 1;
+			switch ( c)
+			{
+				case '"': iStream.write( "\\\"", 2); break;
+				case '\\': iStream.write( "\\\\", 2); break;
+				case '\n': iStream.write( "\\n", 2); break;
+				case '\r': iStream.write( "\\r", 2); break;
+				case '\t': iStream.write( "\\t", 2); break;
+				default:
+				{
+					const char escaped[] = { '\\', 'u', '0', '0', hex[ c >> 4], hex[ c & 15] };
+					iStream.write( escaped, sizeof(escaped));
+				}
+			}
+		}
+
+		iStream.write( data + start, size - start);
+		iStream.put( '"');
+	}
+
+	void writeJson( std::ostream& stream, const PlatformRecordArray& platforms)
+	{
+		JsonWriter writer( stream);
+		writer.beginObject();
+		writer.key( "schemaVersion").value( static_cast<uint>( Binary::schemaVersion));
+		writer.key( "platforms").beginArray();
+		for ( auto p = platforms.begin(); p != platforms.end(); ++p)
+		{
+			writer.beginObject();
+			writer.key( "name").value( p->platform().name());
+			writer.key( "vendor").value( p->platform().vendor());
+			writer.key( "version").value( p->platform().version());
+			writer.key( "devices").beginArray();
+			for ( auto d = p->devices().begin(); d != p->devices().end(); ++d)
+			{
+				writeJson( writer, *d);
+			}
+
+			writer.endArray();
+			writer.endObject();
+		}
+
+		writer.endArray();
+		writer.endObject();
+		stream.put( '\n');
+	}
+
+	void writeBinary( std::ostream& stream, const PlatformRecordArray& platforms)
+	{
+		Binary::Header header;
+		header.magic = Binary::magic;
+		header.schemaVersion = Binary::schemaVersion;
+		header.platformCount = static_cast<uint>( platforms.size());
+		header.deviceCount = 0;
+		for ( auto p = platforms.begin(); p != platforms.end(); ++p)
+		{
+			header.deviceCount += static_cast<uint>( p->devices().size());
+		}
+
+		stream.write( reinterpret_cast<const char*>( &header), sizeof(header));
+		for ( auto p = platforms.begin(); p != platforms.end(); ++p)
+		{
+			writeBinary( stream, p->platform(), static_cast<uint>( p->devices().size()));
+			for ( auto d = p->devices().begin(); d != p->devices().end(); ++d)
+			{
+				writeBinary( stream, *d);
+			}
+		}
+	}
+
+	bool StringRef::operator==( const char* const item) const
+	{
+		return strlen( item) == iSize && !memcmp( iData, item, iSize);
+	}
+
+	bool DeviceView::hasExtension( const char* const name) const
+	{
+		const auto& extensions = iStrings[ Binary::dsExtensions];
+		const auto size = strlen( name);
+		const auto end = extensions.data() + extensions.size();
+		for ( auto start = extensions.data(); start < end;)
+		{
+			auto stop = static_cast<const char*>( memchr( start, ' ', end - start));
+			stop = stop ? stop : end;
+			if ( static_cast<size_t>( stop - start) == size && !memcmp( start, name, size))
+			{
+				return true;
+			}
+
+			start = stop + 1;
+		}
+
+		return false;
+	}
+
+	BinaryReader::BinaryReader( const void* const data, const size_t size):
+		iData( static_cast<const char*>( data)),
+		iSize( size),
+		iOffset( sizeof(Binary::Header)),
+		iHeader( nullptr)
+	{
+		if ( size < sizeof(Binary::Header) || reinterpret_cast<size_t>( data) % 8)
+		{
+			return;
+		}
+
+		const auto header = reinterpret_cast<const Binary::Header*>( data);
+		if ( header->magic == Binary::magic && header->schemaVersion == Binary::schemaVersion)
+		{
+			iHeader = header;
+		}
+	}
+
+	void BinaryReader::rewind()
+	{
+		iOffset = sizeof(Binary::Header);
+	}
+
+	bool BinaryReader::strings( StringRef* const result, const size_t count, size_t offset, const size_t end) const
+	{
+		for ( size_t i = 0; i < count; ++i)
+		{
+			uint length;
+			if ( end - offset < sizeof(length))
+			{
+				return false;
+			}
+
+			memcpy( &length, iData + offset, sizeof(length));
+			offset += sizeof(length);
+			if ( end - offset < length)
+			{
+				return false;
+			}
+
+			result[ i] = StringRef( iData + offset, length);
+			offset += length;
+		}
+
+		return true;
+	}
+
+	bool BinaryReader::next( PlatformView& view)
+	{
+		if ( !iHeader || iSize - iOffset < sizeof(Binary::PlatformBlock))
+		{
+			return false;
+		}
+
+		const auto block = reinterpret_cast<const Binary::PlatformBlock*>( iData + iOffset);
+		if ( block->size < sizeof(*block) || block->size % 8 || block->size > iSize - iOffset ||
+			!strings( view.iStrings, Binary::platformStringCount, iOffset + sizeof(*block), iOffset + block->size))
+		{
+			return false;
+		}
+
+		view.iBlock = block;
+		iOffset += block->size;
+		return true;
+	}
+
+	bool BinaryReader::next( DeviceView& view)
+	{
+		if ( !iHeader || iSize - iOffset < sizeof(Binary::DeviceBlock))
+		{
+			return false;
+		}
+
+		const auto block = reinterpret_cast<const Binary::DeviceBlock*>( iData + iOffset);
+		if ( block->size < sizeof(*block) || block->size % 8 || block->size > iSize - iOffset ||
+			!strings( view.iStrings, Binary::deviceStringCount, iOffset + sizeof(*block), iOffset + block->size))
+		{
+			return false;
+		}
+
+		view.iBlock = block;
+		iOffset += block->size;
+		return true;
+	}
+
+	void read( Platform& item, const PlatformView& view)
+	{
+		item.setName( view.string( Binary::psName).str());
+		item.setVendor( view.string( Binary::psVendor).str());
+		item.setVersion( view.string( Binary::psVersion).str());
+	}
+
+	void read( Device& item, const DeviceView& view)
+	{
+		const auto& block = view.block();
+		item.setName( view.string( Binary::dsName).str());
+		item.setVendor( view.string( Binary::dsVendor).str());
+		item.setVersion( view.string( Binary::dsVersion).str());
+		item.setDriverVersion( view.string( Binary::dsDriverVersion).str());
+		item.setOpenClVersion( view.string( Binary::dsOpenClVersion).str());
+		item.setProfile( view.string( Binary::dsProfile).str());
+
+		{
+			ExtensionArray extensions;
+			const auto text = view.string( Binary::dsExtensions);
+			const auto end = text.data() + text.size();
+			for ( auto start = text.data(); start < end;)
+			{
+				auto stop = static_cast<const char*>( memchr( start, ' ', end - start));
+				stop = stop ? stop : end;
+				extensions.push_back( std::string( start, stop));
+				start = stop + 1;
+			}
+
+			item.setExtensions( extensions);
+		}
+
+		item.setAvailable( ( block.flags & dfAvailable) != 0);
+		item.setCompilerAvailable( ( block.flags & dfCompilerAvailable) != 0);
+		item.setLinkerAvailable( ( block.flags & dfLinkerAvailable) != 0);
+		item.setLittleEndian( ( block.flags & dfLittleEndian) != 0);
+		item.setHostUnifiedMemory( ( block.flags & dfHostUnifiedMemory) != 0);
+		item.setErrorCorrectionSupport( ( block.flags & dfErrorCorrectionSupport) != 0);
+		item.setPreferredInteropUserSync( ( block.flags & dfPreferredInteropUserSync) != 0);
+
+		{
+			Cache cache;
+			cache.setSize( block.globalCacheSize);
+			cache.setLineSize( block.globalCacheLineSize);
+			cache.setType( static_cast<Cache::Type>( block.globalCacheType));
+
+			GlobalMemory memory;
+			memory.setSize( block.globalMemorySize);
+			memory.setCache( cache);
+			item.setGlobalMemory( memory);
+		}
+
+		{
+			LocalMemory memory;
+			memory.setSize( block.localMemorySize);
+			memory.setType( static_cast<LocalMemory::Type>( block.localMemoryType));
+			item.setLocalMemory( memory);
+		}
+
+		if ( block.flags & dfImageSupport)
+		{
+			auto image = std::make_shared<Image>();
+
+			Image2DMax max2D;
+			max2D.setWidth( static_cast<size_t>( block.image2DMax[ 0]));
+			max2D.setHeight( static_cast<size_t>( block.image2DMax[ 1]));
+			image->setMax2D( max2D);
+
+			Image3DMax max3D;
+			max3D.setWidth( static_cast<size_t>( block.image3DMax[ 0]));
+			max3D.setHeight( static_cast<size_t>( block.image3DMax[ 1]));
+			max3D.setDepth( static_cast<size_t>( block.image3DMax[ 2]));
+			image->setMax3D( max3D);
+
+			image->setMaxBufferSize( static_cast<size_t>( block.imageMaxBufferSize));
+			image->setMaxArraySize( static_cast<size_t>( block.imageMaxArraySize));
+			item.setImage( image);
+		}
+		else
+		{
+			item.setImage( nullptr);
+		}
+
+		item.setMaxMemoryAllocSize( block.maxMemoryAllocSize);
+		item.setMaxConstantBufferSize( block.maxConstantBufferSize);
+		item.setMaxParameterSize( block.maxParameterSize);
+		item.setMaxWorkGroupSize( static_cast<size_t>( block.maxWorkGroupSize));
+
+		{
+			Device::SizeTArray sizes;
+			for ( uint d = 0; d < 3 && d < block.maxWorkItemDimensions; ++d)
+			{
+				sizes.push_back( static_cast<size_t>( block.maxWorkItemSizes[ d]));
+			}
+
+			item.setiMaxWorkItemSizes( sizes);
+		}
+
+		item.setProfilingTimerResolution( static_cast<size_t>( block.profilingTimerResolution));
+		item.setPrintfBufferSize( static_cast<size_t>( block.printfBufferSize));
+		item.setNativeVectorWidths( VectorWidthArray( block.nativeVectorWidths, block.nativeVectorWidths + 7));
+		item.setPreferredVectorWidths( VectorWidthArray( block.preferredVectorWidths, block.preferredVectorWidths + 7));
+		item.setVendorId( block.vendorId);
+		item.setMaxComputeUnits( block.maxComputeUnits);
+		item.setMaxClockFrequency( block.maxClockFrequency);
+		item.setMaxConstantArgs( block.maxConstantArgs);
+		item.setMaxReadImageArguments( block.maxReadImageArguments);
+		item.setMaxWriteImageArguments( block.maxWriteImageArguments);
+		item.setMaxSamplers( block.maxSamplers);
+		item.setMaxWorkItemDimensions( block.maxWorkItemDimensions);
+		item.setAddressBits( block.addressBits);
+		item.setMemoryBaseAddressAlignment( block.memoryBaseAddressAlignment);
+		item.setMinDataTypeAlignSize( block.minDataTypeAlignSize);
+		item.setReferenceCount( block.referenceCount);
+
+		{
+			DeviceTypeArray types;
+			unmask( types, block.typeMask);
+			item.setType( types);
+
+			FPCapabilityArray capabilities;
+			unmask( capabilities, block.singleFpMask);
+			item.setSingleFpCapabilities( capabilities);
+			unmask( capabilities, block.doubleFpMask);
+			item.setDoubleFpCapabilities( capabilities);
+			unmask( capabilities, block.halfFpMask);
+			item.setHalfFpCapabilities( capabilities);
+
+			ExecutionCapabilityArray execution;
+			unmask( execution, block.executionMask);
+			item.setExecutionCapabilities( execution);
+
+			QueuePropertyArray properties;
+			unmask( properties, block.queueMask);
+			item.setQueueProperties( properties);
+		}
+
+		{
+			AffinityDomainArray domains;
+			unmask( domains, block.affinityDomainMask);
+
+			Partition partition;
+			partition.setMaxSubDevices( block.partitionMaxSubDevices);
+			partition.setProperties( 0);
+			partition.setAffinityDomains( domains);
+			item.setPartition( partition);
+		}
+	}
+}
@@ -0,0 +1,236 @@
+#pragma once
+#ifndef PCHDR
+	#include "Discovery.h"
+	#include <ostream>
+	#include <string>
+#endif
+
+namespace Info
+{
+	// streams JSON straight to the output without building a document
+	class JsonWriter
+	{
+	public:
+		explicit JsonWriter( std::ostream& stream);
+
+		JsonWriter& beginObject();
+		JsonWriter& endObject();
+		JsonWriter& beginArray();
+		JsonWriter& endArray();
+		JsonWriter& key( const char* const name);
+
+		JsonWriter& value( const std::string& item);
+		JsonWriter& value( const char* const item);
+		JsonWriter& value( const uint item);
+		JsonWriter& value( const ulong item);
+		JsonWriter& value( const bool item);
+
+	private:
+		JsonWriter( const JsonWriter&);
+		JsonWriter& operator=( const JsonWriter&);
+
+		enum { maxDepth = 32 };
+
+		void separate();
+		void string( const char* const data, const size_t size);
+
+		std::ostream&	iStream;
+		bool			iFirst[ maxDepth];
+		int				iDepth;
+		bool			iAfterKey;
+	};
+
+	void writeJson( std::ostream& stream, const PlatformRecordArray& platforms);
+
+	// Compact snapshot format, host byte order (a swapped magic is rejected), 8-byte aligned records:
+	//   Header, then per platform a PlatformBlock + strings, followed by its
+	//   devices, each a DeviceBlock + strings. A string is a uint length and
+	//   its bytes; the strings of a record are padded to 8 bytes together.
+	namespace Binary
+	{
+		enum
+		{
+			magic			= 0x424C434F,	// "OCLB"
+			schemaVersion	= 1
+		};
+
+		class Header
+		{
+		public:
+			uint	magic;
+			uint	schemaVersion;
+			uint	platformCount;
+			uint	deviceCount;
+		};
+
+		enum PlatformString
+		{
+			psName,
+			psVendor,
+			psVersion,
+			platformStringCount
+		};
+
+		class PlatformBlock
+		{
+		public:
+			uint	size;			// whole record including strings and padding
+			uint	deviceCount;
+		};
+
+		enum DeviceString
+		{
+			dsName,
+			dsVendor,
+			dsVersion,
+			dsDriverVersion,
+			dsOpenClVersion,
+			dsProfile,
+			dsExtensions,			// space separated
+			deviceStringCount
+		};
+
+		class DeviceBlock
+		{
+		public:
+			uint	size;			// whole record including strings and padding
+			uint	flags;			// DeviceFlag
+			ulong	globalMemorySize;
+			ulong	globalCacheSize;
+			ulong	localMemorySize;
+			ulong	maxMemoryAllocSize;
+			ulong	maxConstantBufferSize;
+			ulong	maxParameterSize;
+			ulong	maxWorkGroupSize;
+			ulong	maxWorkItemSizes[ 3];
+			ulong	profilingTimerResolution;
+			ulong	printfBufferSize;
+			ulong	image2DMax[ 2];	// width, height
+			ulong	image3DMax[ 3];	// width, height, depth
+			ulong	imageMaxBufferSize;
+			ulong	imageMaxArraySize;
+			uint	nativeVectorWidths[ 7];
+			uint	preferredVectorWidths[ 7];
+			uint	vendorId;
+			uint	maxComputeUnits;
+			uint	maxClockFrequency;
+			uint	maxConstantArgs;
+			uint	maxReadImageArguments;
+			uint	maxWriteImageArguments;
+			uint	maxSamplers;
+			uint	maxWorkItemDimensions;
+			uint	addressBits;
+			uint	memoryBaseAddressAlignment;
+			uint	minDataTypeAlignSize;
+			uint	globalCacheLineSize;
+			uint	globalCacheType;		// Cache::Type
+			uint	localMemoryType;		// LocalMemory::Type
+			uint	referenceCount;
+			uint	partitionMaxSubDevices;
+			uint	typeMask;				// 1 << DeviceType
+			uint	singleFpMask;			// 1 << FPCapability
+			uint	doubleFpMask;
+			uint	halfFpMask;
+			uint	executionMask;			// 1 << ExecutionCapability
+			uint	queueMask;				// 1 << QueueProperty
+			uint	affinityDomainMask;		// 1 << AffinityDomain
+			uint	pciDomain;
+			uint	pciBus;
+			uint	pciDevice;
+			uint	pciFunction;
+			uint	reserved;
+		};
+	}
+
+	void writeBinary( std::ostream& stream, const PlatformRecordArray& platforms);
+
+	class StringRef
+	{
+	public:
+		StringRef():
+			iData( nullptr),
+			iSize( 0)
+		{}
+
+		StringRef( const char* const data, const size_t size):
+			iData( data),
+			iSize( size)
+		{}
+
+		const char* data() const { return iData; }
+		size_t size() const { return iSize; }
+		std::string str() const { return std::string( iData, iSize); }
+
+		bool operator==( const char* const item) const;
+
+	private:
+		const char*	iData;
+		size_t		iSize;
+	};
+
+	// views point into the reader's buffer and stay valid as long as it does
+	class PlatformView
+	{
+	public:
+		PlatformView():
+			iBlock( nullptr)
+		{}
+
+		const Binary::PlatformBlock& block() const { return *iBlock; }
+		uint deviceCount() const { return iBlock->deviceCount; }
+		StringRef string( const Binary::PlatformString index) const { return iStrings[ index]; }
+
+	private:
+		friend class BinaryReader;
+
+		const Binary::PlatformBlock*	iBlock;
+		StringRef						iStrings[ Binary::platformStringCount];
+	};
+
+	class DeviceView
+	{
+	public:
+		DeviceView():
+			iBlock( nullptr)
+		{}
+
+		const Binary::DeviceBlock& block() const { return *iBlock; }
+		StringRef string( const Binary::DeviceString index) const { return iStrings[ index]; }
+
+		bool hasExtension( const char* const name) const;
+
+	private:
+		friend class BinaryReader;
+
+		const Binary::DeviceBlock*	iBlock;
+		StringRef					iStrings[ Binary::deviceStringCount];
+	};
+
+	// Reads a snapshot in place. Records are returned in file order: a platform
+	// followed by its deviceCount() devices.
+	class BinaryReader
+	{
+	public:
+		BinaryReader( const void* const data, const size_t size);
+
+		bool isValid() const { return iHeader != nullptr; }
+		const Binary::Header& header() const { return *iHeader; }
+
+		bool next( PlatformView& view);
+		bool next( DeviceView& view);
+
+		void rewind();
+
+	private:
+		bool strings( StringRef* const result, const size_t count, size_t offset, const size_t end) const;
+
+		const char*				iData;
+		size_t					iSize;
+		size_t					iOffset;
+		const Binary::Header*	iHeader;
+	};
+
+	// rebuilds the records; allocates, unlike the views
+	void read( Platform& item, const PlatformView& view);
+	void read( Device& item, const DeviceView& view);
+}
@@ -0,0 +1,340 @@
+#include "stdafx.h"
+#include "SharedSnapshot.h"
+#include <thread>
+
+#ifdef _WIN32
+	#include <windows.h>
+#else
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <unistd.h>
+#endif
+
+namespace Info
+{
+	namespace Shared
+	{
+		namespace
+		{
+			// a publish takes microseconds; this many yields means the writer is gone
+			const uint readAttempts = 100000;
+
+			template <size_t N>
+			void copyText( char ( &target)[ N], const std::string& source)
+			{
+				const auto size = source.size() < N ? source.size() : N - 1;
+				memcpy( target, source.data(), size);
+				target[ size] = 0;
+			}
+
+			std::string segmentName( const std::string& name)
+			{
+			#ifdef _WIN32
+				return "Local\\" + name;
+			#else
+				return "/" + name;
+			#endif
+			}
+
+			void* map( void*& handle, const std::string& name, const bool writable)
+			{
+				const auto path = segmentName( name);
+			#ifdef _WIN32
+				handle = writable ?
+					CreateFileMappingA( INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, sizeof(Segment), path.c_str()) :
+					OpenFileMappingA( FILE_MAP_READ, FALSE, path.c_str());
+				if ( !handle)
+				{
+					return nullptr;
+				}
+
+				auto view = MapViewOfFile( handle, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, sizeof(Segment));
+				if ( !view)
+				{
+					CloseHandle( handle);
+					handle = nullptr;
+				}
+
+				return view;
+			#else
+				handle = nullptr;
+				const int descriptor = shm_open( path.c_str(), writable ? O_CREAT | O_RDWR : O_RDONLY, 0644);
+				if ( descriptor < 0)
+				{
+					return nullptr;
+				}
+
+				if ( writable && ftruncate( descriptor, sizeof(Segment)))
+				{
+					close( descriptor);
+					return nullptr;
+				}
+
+				auto view = mmap( nullptr, sizeof(Segment), writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, descriptor, 0);
+				close( descriptor);
+				return view == MAP_FAILED ? nullptr : view;
+			#endif
+			}
+
+			void unmap( const void* const view, void* const handle)
+			{
+			#ifdef _WIN32
+				UnmapViewOfFile( view);
+				CloseHandle( handle);
+			#else
+				munmap( const_cast<void*>( view), sizeof(Segment));
+			#endif
+			}
+		}
+
+		void copy( PlatformEntry& entry, const Platform& platform)
+		{
+			memset( &entry, 0, sizeof(entry));
+			copyText( entry.name, platform.name());
+			copyText( entry.vendor, platform.vendor());
+			copyText( entry.version, platform.version());
+		}
+
+		void copy( DeviceEntry& entry, const DeviceInstance& instance)
+		{
+			memset( &entry, 0, sizeof(entry));
+			if ( !instance.record())
+			{
+				return;
+			}
+
+			const auto& device = *instance.record();
+			copyText( entry.name, device.name());
+			copyText( entry.vendor, device.vendor());
+			copyText( entry.version, device.version());
+			copyText( entry.driverVersion, device.driverVersion());
+			copyText( entry.profile, device.profile());
+
+			{
+				std::string extensions;
+				for ( auto i = device.extensions().begin(); i != device.extensions().end(); ++i)
+				{
+					if ( extensions.size() + i->size() + 1 >= extensionsSize)
+					{
+						break;
+					}
+
+					extensions += ( extensions.empty() ? "" : " ") + *i;
+				}
+
+				copyText( entry.extensions, extensions);
+			}
+
+			entry.globalMemorySize = device.globalMemory().size();
+			entry.globalCacheSize = device.globalMemory().cache().size();
+			entry.globalCacheLineSize = device.globalMemory().cache().lineSize();
+			entry.localMemorySize = device.localMemory().size();
+			entry.maxMemoryAllocSize = device.maxMemoryAllocSize();
+			entry.maxConstantBufferSize = device.maxConstantBufferSize();
+			entry.maxParameterSize = device.maxParameterSize();
+			entry.maxWorkGroupSize = device.maxWorkGroupSize();
+			for ( size_t d = 0; d < 3 && d < device.maxWorkItemSizes().size(); ++d)
+			{
+				entry.maxWorkItemSizes[ d] = device.maxWorkItemSizes()[ d];
+			}
+
+			entry.profilingTimerResolution = device.profilingTimerResolution();
+			for ( size_t w = 0; w < 7; ++w)
+			{
+				entry.nativeVectorWidths[ w] = w < device.nativeVectorWidths().size() ? device.nativeVectorWidths()[ w] : 0;
+				entry.preferredVectorWidths[ w] = w < device.preferredVectorWidths().size() ? device.preferredVectorWidths()[ w] : 0;
+			}
+
+			entry.vendorId = device.vendorId();
+			entry.maxComputeUnits = device.maxComputeUnits();
+			entry.maxClockFrequency = device.maxClockFrequency();
+			entry.maxConstantArgs = device.maxConstantArgs();
+			entry.maxWorkItemDimensions = device.maxWorkItemDimensions();
+			entry.addressBits = device.addressBits();
+			entry.memoryBaseAddressAlignment = device.memoryBaseAddressAlignment();
+
+			const auto& pci = instance.pciLocation();
+			if ( pci.isValid())
+			{
+				entry.pciDomain = pci.domain();
+				entry.pciBus = pci.bus();
+				entry.pciDevice = pci.device();
+				entry.pciFunction = pci.function();
+			}
+
+			entry.flags = flags( instance);
+		}
+	}
+
+	SharedSnapshotWriter::SharedSnapshotWriter( const std::string& name):
+		iName( name),
+		iSegment( nullptr),
+		iHandle( nullptr)
+	{
+		iSegment = static_cast<Shared::Segment*>( Shared::map( iHandle, name, true));
+		if ( iSegment)
+		{
+			// a segment left behind by a writer that crashed mid-publish may hold an odd generation;
+			// invalidate it, reset to an empty snapshot and only then mark it valid again
+			auto& header = iSegment->header;
+			header.magic = 0;
+			header.platformCount = 0;
+			header.deviceCount = 0;
+			header.generation.store( 0, std::memory_order_relaxed);
+			std::atomic_thread_fence( std::memory_order_release);
+			header.version = Shared::version;
+			header.magic = Shared::magic;
+		}
+	}
+
+	SharedSnapshotWriter::~SharedSnapshotWriter()
+	{
+		if ( iSegment)
+		{
+			Shared::unmap( iSegment, iHandle);
+		#ifndef _WIN32
+			shm_unlink( Shared::segmentName( iName).c_str());
+		#endif
+		}
+	}
+
+	void SharedSnapshotWriter::publish( const PlatformRecordArray& platforms)
+	{
+		if ( !iSegment)
+		{
+			return;
+		}
+
+		auto& header = iSegment->header;
+		const auto generation = header.generation.load( std::memory_order_relaxed);
+		header.generation.store( generation + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence( std::memory_order_release);
+
+		uint platformCount = 0;
+		uint deviceCount = 0;
+		for ( auto p = platforms.begin(); p != platforms.end() && platformCount < Shared::maxPlatforms; ++p)
+		{
+			auto& platformEntry = iSegment->platforms[ platformCount];
+			Shared::copy( platformEntry, p->platform());
+			platformEntry.firstDevice = deviceCount;
+
+			for ( auto d = p->devices().begin(); d != p->devices().end() && deviceCount < Shared::maxDevices; ++d)
+			{
+				auto& deviceEntry = iSegment->devices[ deviceCount++];
+				Shared::copy( deviceEntry, *d);
+				deviceEntry.platform = platformCount;
+			}
+
+			platformEntry.deviceCount = deviceCount - platformEntry.firstDevice;
+			++platformCount;
+		}
+
+		header.platformCount = platformCount;
+		header.deviceCount = deviceCount;
+		header.generation.store( generation + 2, std::memory_order_release);
+	}
+
+	SharedSnapshotReader::SharedSnapshotReader( const std::string& name):
+		iSegment( nullptr),
+		iHandle( nullptr)
+	{
+		iSegment = static_cast<const Shared::Segment*>( Shared::map( iHandle, name, false));
+		if ( iSegment && ( iSegment->header.magic != Shared::magic || iSegment->header.version != Shared::version))
+		{
+			Shared::unmap( iSegment, iHandle);
+			iSegment = nullptr;
+		}
+	}
+
+	SharedSnapshotReader::~SharedSnapshotReader()
+	{
+		if ( iSegment)
+		{
+			Shared::unmap( iSegment, iHandle);
+		}
+	}
+
+	unsigned int SharedSnapshotReader::generation() const
+	{
+		return iSegment ? iSegment->header.generation.load( std::memory_order_acquire) : 0;
+	}
+
+	template <typename Copy>
+	bool SharedSnapshotReader::readUnchanged( unsigned int& generation, const Copy& copy) const
+	{
+		for ( uint attempt = 0; attempt < Shared::readAttempts; ++attempt)
+		{
+			const auto before = iSegment->header.generation.load( std::memory_order_acquire);
+			if ( !( before & 1))
+			{
+				copy();
+				std::atomic_thread_fence( std::memory_order_acquire);
+				if ( iSegment->header.generation.load( std::memory_order_relaxed) == before)
+				{
+					generation = before;
+					return true;
+				}
+			}
+
+			std::this_thread::yield();
+		}
+
+		// the writer never finished, most likely it died mid-publish
+		return false;
+	}
+
+	template <typename T>
+	bool SharedSnapshotReader::readConsistent( T& item, const void* const source) const
+	{
+		unsigned int generation;
+		return readUnchanged( generation, [&]() { memcpy( &item, source, sizeof(T)); });
+	}
+
+	bool SharedSnapshotReader::snapshot( Shared::Snapshot& snapshot) const
+	{
+		if ( !iSegment)
+		{
+			return false;
+		}
+
+		// sized for the worst case up front, so the copy itself does not allocate
+		snapshot.platforms.resize( Shared::maxPlatforms);
+		snapshot.devices.resize( Shared::maxDevices);
+		uint platformCount = 0;
+		uint deviceCount = 0;
+		const auto read = readUnchanged( snapshot.generation, [&]()
+		{
+			// counts seen mid-publish are garbage until the generation check rejects them
+			platformCount = std::min<uint>( iSegment->header.platformCount, Shared::maxPlatforms);
+			deviceCount = std::min<uint>( iSegment->header.deviceCount, Shared::maxDevices);
+			memcpy( &snapshot.platforms[ 0], iSegment->platforms, platformCount * sizeof(Shared::PlatformEntry));
+			memcpy( &snapshot.devices[ 0], iSegment->devices, deviceCount * sizeof(Shared::DeviceEntry));
+		});
+
+		snapshot.platforms.resize( read ? platformCount : 0);
+		snapshot.devices.resize( read ? deviceCount : 0);
+		return read;
+	}
+
+	bool SharedSnapshotReader::platformCount( uint& count) const
+	{
+		return iSegment && readConsistent( count, &iSegment->header.platformCount);
+	}
+
+	bool SharedSnapshotReader::deviceCount( uint& count) const
+	{
+		return iSegment && readConsistent( count, &iSegment->header.deviceCount);
+	}
+
+	bool SharedSnapshotReader::platform( const uint index, Shared::PlatformEntry& entry) const
+	{
+		uint count;
+		return platformCount( count) && index < count && index < Shared::maxPlatforms && readConsistent( entry, &iSegment->platforms[ index]);
+	}
+
+	bool SharedSnapshotReader::device( const uint index, Shared::DeviceEntry& entry) const
+	{
+		uint count;
+		return deviceCount( count) && index < count && index < Shared::maxDevices && readConsistent( entry, &iSegment->devices[ index]);
+	}
+}
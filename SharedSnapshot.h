@@ -0,0 +1,162 @@
+#pragma once
+#ifndef PCHDR
+	#include "Discovery.h"
+	#include <atomic>
+	#include <string>
+	#include <vector>
+#endif
+
+namespace Info
+{
+	namespace Shared
+	{
+		enum
+		{
+			magic			= 0x494C434F,	// "OCLI"
+			version			= 1,
+			maxPlatforms	= 16,
+			maxDevices		= 64,
+			textSize		= 128,
+			extensionsSize	= 4096
+		};
+
+		// fixed layout; every string is null terminated and truncated to fit
+		class PlatformEntry
+		{
+		public:
+			char	name[ textSize];
+			char	vendor[ textSize];
+			char	version[ textSize];
+			uint	firstDevice;
+			uint	deviceCount;
+		};
+
+		class DeviceEntry
+		{
+		public:
+			char	name[ textSize];
+			char	vendor[ textSize];
+			char	version[ textSize];
+			char	driverVersion[ textSize];
+			char	profile[ textSize];
+			char	extensions[ extensionsSize];
+			ulong	globalMemorySize;
+			ulong	globalCacheSize;
+			ulong	localMemorySize;
+			ulong	maxMemoryAllocSize;
+			ulong	maxConstantBufferSize;
+			ulong	maxParameterSize;
+			ulong	maxWorkGroupSize;
+			ulong	maxWorkItemSizes[ 3];
+			ulong	profilingTimerResolution;
+			uint	nativeVectorWidths[ 7];
+			uint	preferredVectorWidths[ 7];
+			uint	vendorId;
+			uint	maxComputeUnits;
+			uint	maxClockFrequency;
+			uint	maxConstantArgs;
+			uint	maxWorkItemDimensions;
+			uint	addressBits;
+			uint	memoryBaseAddressAlignment;
+			uint	globalCacheLineSize;
+			uint	flags;
+			uint	platform;
+			uint	pciDomain;
+			uint	pciBus;
+			uint	pciDevice;
+			uint	pciFunction;
+		};
+
+		class Header
+		{
+		public:
+			uint						magic;
+			uint						version;
+			std::atomic<unsigned int>	generation;	// odd while the publisher writes
+			uint						platformCount;
+			uint						deviceCount;
+		};
+
+		class Segment
+		{
+		public:
+			Header			header;
+			PlatformEntry	platforms[ maxPlatforms];
+			DeviceEntry		devices[ maxDevices];
+		};
+
+		// every entry of one generation
+		class Snapshot
+		{
+		public:
+			Snapshot():
+				generation( 0)
+			{}
+
+			unsigned int				generation;
+			std::vector<PlatformEntry>	platforms;
+			std::vector<DeviceEntry>	devices;
+		};
+
+		void copy( PlatformEntry& entry, const Platform& platform);
+		void copy( DeviceEntry& entry, const DeviceInstance& device);
+	}
+
+	// owned by the daemon; creates the named segment and publishes snapshots into it
+	class SharedSnapshotWriter
+	{
+	public:
+		explicit SharedSnapshotWriter( const std::string& name);
+		~SharedSnapshotWriter();
+
+		bool isOpen() const { return iSegment != nullptr; }
+
+		// platforms and devices beyond the segment capacity are dropped
+		void publish( const PlatformRecordArray& platforms);
+
+	private:
+		SharedSnapshotWriter( const SharedSnapshotWriter&);
+		SharedSnapshotWriter& operator=( const SharedSnapshotWriter&);
+
+		std::string			iName;
+		Shared::Segment*	iSegment;
+		void*				iHandle;
+	};
+
+	// maps the segment read-only; lookups are plain memory reads retried while a publish is in flight
+	class SharedSnapshotReader
+	{
+	public:
+		explicit SharedSnapshotReader( const std::string& name);
+		~SharedSnapshotReader();
+
+		bool isOpen() const { return iSegment != nullptr; }
+
+		// 0 until the first snapshot was published
+		unsigned int generation() const;
+
+		// counts and entries copied in one pass, so they always belong together
+		bool snapshot( Shared::Snapshot& snapshot) const;
+
+		// each call reads on its own, so a publish between calls mixes generations; snapshot() does not
+		// false when the index is out of range, the segment is not open or a publish never completes
+		bool platformCount( uint& count) const;
+		bool deviceCount( uint& count) const;
+		bool platform( const uint index, Shared::PlatformEntry& entry) const;
+		bool device( const uint index, Shared::DeviceEntry& entry) const;
+
+	private:
+		SharedSnapshotReader( const SharedSnapshotReader&);
+		SharedSnapshotReader& operator=( const SharedSnapshotReader&);
+
+		// runs copy until it sees no publish; generation is the one copied
+		template <typename Copy>
+		bool readUnchanged( unsigned int& generation, const Copy& copy) const;
+
+		template <typename T>
+		bool readConsistent( T& item, const void* const source) const;
+
+		const Shared::Segment*	iSegment;
+		void*					iHandle;
+	};
+}
@@ -0,0 +1,526 @@
+#include "stdafx.h"
+#include "SnapshotDiff.h"
+#include "FleetStore.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <sstream>
+
+namespace Info
+{
+	namespace
+	{
+		// measured changes outrank capability changes of the same relative size
+		const double measurementWeight = 2.0;
+		const double missingDeviceWeight = 4.0;
+
+		const char* const vectorTypeNames[] = { "char", "short", "int", "long", "float", "double", "half" };
+
+		class Field
+		{
+		public:
+			const char*	name;
+			size_t		offset;
+			bool		isUlong;
+			double		weight;
+			bool		higherIsBetter;
+		};
+
+		#define INFO_FIELD( name, type, weight, higherIsBetter) { #name, offsetof( Binary::DeviceBlock, name), sizeof(type) == sizeof(ulong), weight, higherIsBetter }
+
+		const Field fields[] =
+		{
+			INFO_FIELD( maxComputeUnits, uint, 1.0, true),
+			INFO_FIELD( maxWorkGroupSize, ulong, 1.0, true),
+			INFO_FIELD( maxClockFrequency, uint, 0.8, true),
+			INFO_FIELD( localMemorySize, ulong, 0.8, true),
+			INFO_FIELD( globalCacheSize, ulong, 0.5, true),
+			INFO_FIELD( globalMemorySize, ulong, 0.5, true),
+			INFO_FIELD( maxMemoryAllocSize, ulong, 0.5, true),
+			INFO_FIELD( maxConstantBufferSize, ulong, 0.4, true),
+			INFO_FIELD( globalCacheLineSize, uint, 0.3, true),
+			INFO_FIELD( maxConstantArgs, uint, 0.2, true),
+			INFO_FIELD( maxParameterSize, ulong, 0.2, true),
+			INFO_FIELD( profilingTimerResolution, ulong, 0.1, false)
+		};
+
+		#undef INFO_FIELD
+
+		// losing one of these breaks workloads outright
+		const uint criticalFlags = dfAvailable | dfCompilerAvailable | dfLinkerAvailable | dfImageSupport;
+
+		ulong fieldValue( const Binary::DeviceBlock& block, const Field& field)
+		{
+			const auto address = reinterpret_cast<const char*>( &block) + field.offset;
+			return field.isUlong ? *reinterpret_cast<const ulong*>( address) : *reinterpret_cast<const uint*>( address);
+		}
+
+		template <typename T>
+		std::string text( const T value)
+		{
+			std::ostringstream stream;
+			stream << value;
+			return stream.str();
+		}
+
+		double relative( const double before, const double after)
+		{
+			return before != 0.0 ? ( after - before) / before : after != 0.0 ? 1.0 : 0.0;
+		}
+
+		// complementary error function, Chebyshev fit with fractional error below 1.2e-7
+		double complementaryError( const double x)
+		{
+			const double z = fabs( x);
+			const double t = 1.0 / ( 1.0 + 0.5 * z);
+			const double r = t * exp( -z * z - 1.26551223 + t * ( 1.00002368 + t * ( 0.37409196 + t * ( 0.09678418 +
+				t * ( -0.18628806 + t * ( 0.27886807 + t * ( -1.13520398 + t * ( 1.48851587 + t * ( -0.82215223 + t * 0.17087277)))))))));
+			return x >= 0.0 ? r : 2.0 - r;
+		}
+
+		// a device of a snapshot, named name#n after its position among devices of the same name
+		class DeviceEntry
+		{
+		public:
+			std::string	key;
+			std::string	name;
+			DeviceView	view;
+		};
+
+		typedef std::vector<DeviceEntry> DeviceEntryArray;
+
+		bool collect( DeviceEntryArray& devices, const void* const data, const size_t size)
+		{
+			BinaryReader reader( data, size);
+			if ( !reader.isValid())
+			{
+				return false;
+			}
+
+			std::map<std::string, uint> occurrences;
+			for ( uint p = 0; p < reader.header().platformCount; ++p)
+			{
+				PlatformView platform;
+				if ( !reader.next( platform))
+				{
+					return false;
+				}
+
+				for ( uint d = 0; d < platform.deviceCount(); ++d)
+				{
+					DeviceEntry entry;
+					if ( !reader.next( entry.view))
+					{
+						return false;
+					}
+
+					entry.name = entry.view.string( Binary::dsName).str();
+					entry.key = entry.name + '#' + text( occurrences[ entry.name]++);
+					devices.push_back( entry);
+				}
+			}
+
+			return true;
+		}
+
+		bool samePciLocation( const Binary::DeviceBlock& first, const Binary::DeviceBlock& second)
+		{
+			return ( first.flags & second.flags & dfPciLocation) && first.pciDomain == second.pciDomain && first.pciBus == second.pciBus &&
+				first.pciDevice == second.pciDevice && first.pciFunction == second.pciFunction;
+		}
+
+		// partners[ b] is the index of the after device matching before device b, or -1. Devices are paired by
+		// PCI location where both snapshots report one, the rest by name in order, so a driver starting to
+		// report PCI locations does not rename every device.
+		void pairDevices( std::vector<int>& partners, const DeviceEntryArray& before, const DeviceEntryArray& after)
+		{
+			partners.assign( before.size(), -1);
+			std::vector<bool> taken( after.size(), false);
+			for ( size_t b = 0; b < before.size(); ++b)
+			{
+				for ( size_t a = 0; a < after.size() && partners[ b] < 0; ++a)
+				{
+					if ( !taken[ a] && before[ b].name == after[ a].name && samePciLocation( before[ b].view.block(), after[ a].view.block()))
+					{
+						partners[ b] = static_cast<int>( a);
+						taken[ a] = true;
+					}
+				}
+			}
+
+			for ( size_t b = 0; b < before.size(); ++b)
+			{
+				for ( size_t a = 0; a < after.size() && partners[ b] < 0; ++a)
+				{
+					if ( !taken[ a] && before[ b].name == after[ a].name)
+					{
+						partners[ b] = static_cast<int>( a);
+						taken[ a] = true;
+					}
+				}
+			}
+		}
+
+		bool hasExtension( const DeviceView& device, const char* const data, const size_t size)
+		{
+			return device.hasExtension( std::string( data, size).c_str());
+		}
+
+		bool isAbove( const Difference& first, const Difference& second)
+		{
+			return first.kind() != second.kind() ? first.kind() < second.kind() : first.score() > second.score();
+		}
+	}
+
+	bool loadMeasurements( MeasurementArray& measurements, const std::string& path)
+	{
+		measurements.clear();
+		std::ifstream file( path.c_str());
+		if ( !file)
+		{
+			return false;
+		}
+
+		std::string line;
+		while ( std::getline( file, line))
+		{
+			std::istringstream stream( line);
+			std::string device, name, direction, samplesText;
+			if ( !std::getline( stream, device, '\t') || !std::getline( stream, name, '\t') || !std::getline( stream, direction, '\t'))
+			{
+				continue;
+			}
+
+			std::getline( stream, samplesText);
+
+			Measurement item;
+			item.setDevice( device);
+			item.setName( name);
+			item.setHigherIsBetter( direction != "lower");
+
+			{
+				std::vector<double> samples;
+				std::istringstream values( samplesText);
+				double value;
+				while ( values >> value)
+				{
+					samples.push_back( value);
+				}
+
+				item.setSamples( samples);
+			}
+
+			measurements.push_back( item);
+		}
+
+		return true;
+	}
+
+	bool saveMeasurements( const std::string& path, const MeasurementArray& measurements)
+	{
+		std::ofstream file( path.c_str(), std::ios::trunc);
+		for ( auto i = measurements.begin(); i != measurements.end(); ++i)
+		{
+			file << i->device() << '\t' << i->name() << '\t' << ( i->higherIsBetter() ? "higher" : "lower") << '\t';
+			for ( size_t s = 0; s < i->samples().size(); ++s)
+			{
+				file << ( s ? " " : "") << i->samples()[ s];
+			}
+
+			file << '\n';
+		}
+
+		return file.good();
+	}
+
+	double mannWhitney( const std::vector<double>& first, const std::vector<double>& second)
+	{
+		const double n1 = static_cast<double>( first.size());
+		const double n2 = static_cast<double>( second.size());
+		if ( first.size() < 2 || second.size() < 2)
+		{
+			return 1.0;
+		}
+
+		// pooled samples tagged with their group, ranked with ties sharing the average rank
+		std::vector<std::pair<double, bool> > pooled;
+		for ( auto i = first.begin(); i != first.end(); ++i)
+		{
+			pooled.push_back( std::make_pair( *i, true));
+		}
+
+		for ( auto i = second.begin(); i != second.end(); ++i)
+		{
+			pooled.push_back( std::make_pair( *i, false));
+		}
+
+		std::sort( pooled.begin(), pooled.end());
+
+		double firstRanks = 0.0;
+		double ties = 0.0;
+		for ( size_t i = 0; i < pooled.size();)
+		{
+			size_t j = i;
+			while ( j < pooled.size() && pooled[ j].first == pooled[ i].first)
+			{
+				++j;
+			}
+
+			const double rank = ( i + j + 1) / 2.0;
+			for ( size_t k = i; k < j; ++k)
+			{
+				firstRanks += pooled[ k].second ? rank : 0.0;
+			}
+
+			const double count = static_cast<double>( j - i);
+			ties += count * count * count - count;
+			i = j;
+		}
+
+		const double n = n1 + n2;
+		const double u = firstRanks - n1 * ( n1 + 1.0) / 2.0;
+		const double mean = n1 * n2 / 2.0;
+		const double variance = n1 * n2 / 12.0 * ( ( n + 1.0) - ties / ( n * ( n - 1.0)));
+		if ( variance <= 0.0)
+		{
+			return 1.0;
+		}
+
+		// continuity correction towards the mean
+		const double distance = std::max( fabs( u - mean) - 0.5, 0.0);
+		return std::min( 1.0, complementaryError( distance / sqrt( variance) / sqrt( 2.0)));
+	}
+
+	void SnapshotDiff::add( const std::string& device, const std::string& field, const ulong before, const ulong after, const double weight, const bool higherIsBetter)
+	{
+		if ( before == after)
+		{
+			return;
+		}
+
+		const auto change = relative( static_cast<double>( before), static_cast<double>( after));
+		Difference item;
+		item.setDevice( device);
+		item.setField( field);
+		item.setBefore( text( before));
+		item.setAfter( text( after));
+		item.setRelativeChange( change);
+		item.setScore( weight * std::min( fabs( change), 1.0));
+		item.setKind( ( change > 0.0) == higherIsBetter ? Difference::kImprovement : Difference::kRegression);
+		iDifferences.push_back( item);
+	}
+
+	bool SnapshotDiff::compare( const void* const before, const size_t beforeSize, const void* const after, const size_t afterSize)
+	{
+		DeviceEntryArray beforeDevices;
+		DeviceEntryArray afterDevices;
+		if ( !collect( beforeDevices, before, beforeSize) || !collect( afterDevices, after, afterSize))
+		{
+			return false;
+		}
+
+		std::vector<int> partners;
+		pairDevices( partners, beforeDevices, afterDevices);
+
+		std::vector<bool> matched( afterDevices.size(), false);
+		for ( size_t i = 0; i < beforeDevices.size(); ++i)
+		{
+			const auto& name = beforeDevices[ i].key;
+			if ( partners[ i] < 0)
+			{
+				Difference item;
+				item.setDevice( name);
+				item.setField( "device");
+				item.setBefore( "present");
+				item.setAfter( "missing");
+				item.setScore( missingDeviceWeight);
+				item.setKind( Difference::kRegression);
+				iDifferences.push_back( item);
+				continue;
+			}
+
+			matched[ partners[ i]] = true;
+			const auto& first = beforeDevices[ i].view;
+			const auto& second = afterDevices[ partners[ i]].view;
+			for ( size_t f = 0; f < sizeof(fields) / sizeof(fields[ 0]); ++f)
+			{
+				add( name, fields[ f].name, fieldValue( first.block(), fields[ f]), fieldValue( second.block(), fields[ f]), fields[ f].weight, fields[ f].higherIsBetter);
+			}
+
+			for ( uint w = 0; w < 7; ++w)
+			{
+				add( name, std::string( "preferredVectorWidth.") + vectorTypeNames[ w], first.block().preferredVectorWidths[ w], second.block().preferredVectorWidths[ w], 1.0, true);
+				add( name, std::string( "nativeVectorWidth.") + vectorTypeNames[ w], first.block().nativeVectorWidths[ w], second.block().nativeVectorWidths[ w], 1.0, true);
+			}
+
+			for ( uint d = 0; d < 3; ++d)
+			{
+				add( name, "maxWorkItemSizes." + text( d), first.block().maxWorkItemSizes[ d], second.block().maxWorkItemSizes[ d], 0.5, true);
+			}
+
+			{
+				const auto changed = first.block().flags ^ second.block().flags;
+				for ( uint bit = 0; bit < Fleet::flagCount; ++bit)
+				{
+					const uint flag = 1u << bit;
+					if ( !( changed & flag))
+					{
+						continue;
+					}
+
+					const bool lost = ( first.block().flags & flag) != 0;
+					Difference item;
+					item.setDevice( name);
+					item.setField( flagName( bit));
+					item.setBefore( lost ? "true" : "false");
+					item.setAfter( lost ? "false" : "true");
+					item.setScore( flag & criticalFlags ? 1.0 : 0.2);
+					item.setKind( flag & criticalFlags ? ( lost ? Difference::kRegression : Difference::kImprovement) : Difference::kChange);
+					iDifferences.push_back( item);
+				}
+			}
+
+			// extensions present on one side only
+			for ( int side = 0; side < 2; ++side)
+			{
+				const auto& from = side ? second : first;
+				const auto& to = side ? first : second;
+				const auto list = from.string( Binary::dsExtensions);
+				const auto end = list.data() + list.size();
+				for ( auto start = list.data(); start < end;)
+				{
+					auto stop = static_cast<const char*>( memchr( start, ' ', end - start));
+					stop = stop ? stop : end;
+					if ( stop != start && !hasExtension( to, start, stop - start))
+					{
+						Difference item;
+						item.setDevice( name);
+						item.setField( std::string( start, stop));
+						item.setBefore( side ? "absent" : "present");
+						item.setAfter( side ? "present" : "absent");
+						item.setScore( side ? 0.1 : 0.5);
+						item.setKind( side ? Difference::kImprovement : Difference::kRegression);
+						iDifferences.push_back( item);
+					}
+
+					start = stop + 1;
+				}
+			}
+
+			const Binary::DeviceString strings[] = { Binary::dsDriverVersion, Binary::dsVersion, Binary::dsOpenClVersion };
+			const char* const stringNames[] = { "driverVersion", "version", "openClVersion" };
+			for ( size_t s = 0; s < sizeof(strings) / sizeof(strings[ 0]); ++s)
+			{
+				const auto from = first.string( strings[ s]).str();
+				const auto to = second.string( strings[ s]).str();
+				if ( from != to)
+				{
+					Difference item;
+					item.setDevice( name);
+					item.setField( stringNames[ s]);
+					item.setBefore( from);
+					item.setAfter( to);
+					iDifferences.push_back( item);
+				}
+			}
+		}
+
+		for ( size_t i = 0; i < afterDevices.size(); ++i)
+		{
+			if ( !matched[ i])
+			{
+				Difference item;
+				item.setDevice( afterDevices[ i].key);
+				item.setField( "device");
+				item.setBefore( "missing");
+				item.setAfter( "present");
+				iDifferences.push_back( item);
+			}
+		}
+
+		return true;
+	}
+
+	void SnapshotDiff::compare( const MeasurementArray& before, const MeasurementArray& after)
+	{
+		for ( auto i = before.begin(); i != before.end(); ++i)
+		{
+			auto found = after.begin();
+			while ( found != after.end() && ( found->device() != i->device() || found->name() != i->name()))
+			{
+				++found;
+			}
+
+			if ( found == after.end() || i->samples().empty() || found->samples().empty())
+			{
+				continue;
+			}
+
+			const auto first = median( i->samples());
+			const auto second = median( found->samples());
+			const auto change = relative( first, second);
+			const auto p = mannWhitney( i->samples(), found->samples());
+			if ( p >= iAlpha || fabs( change) < iMinimumEffect)
+			{
+				continue;
+			}
+
+			Difference item;
+			item.setDevice( i->device());
+			item.setField( i->name());
+			item.setBefore( text( first));
+			item.setAfter( text( second));
+			item.setRelativeChange( change);
+			item.setPValue( p);
+			item.setScore( measurementWeight * std::min( fabs( change), 1.0));
+			item.setKind( ( change > 0.0) == i->higherIsBetter() ? Difference::kImprovement : Difference::kRegression);
+			iDifferences.push_back( item);
+		}
+	}
+
+	void SnapshotDiff::rank()
+	{
+		std::stable_sort( iDifferences.begin(), iDifferences.end(), isAbove);
+	}
+
+	DiffResult SnapshotDiff::result() const
+	{
+		if ( iDifferences.empty())
+		{
+			return drUnchanged;
+		}
+
+		for ( auto i = iDifferences.begin(); i != iDifferences.end(); ++i)
+		{
+			if ( i->kind() == Difference::kRegression)
+			{
+				return drRegressed;
+			}
+		}
+
+		return drChanged;
+	}
+
+	void write( std::ostream& stream, const DifferenceArray& differences)
+	{
+		const char* const kindNames[] = { "regression", "improvement", "change" };
+		for ( auto i = differences.begin(); i != differences.end(); ++i)
+		{
+			stream << kindNames[ i->kind()] << '\t' << i->device() << '\t' << i->field() << '\t' << i->before() << '\t' << i->after() << '\t';
+			if ( i->relativeChange() != 0.0)
+			{
+				stream << ( i->relativeChange() > 0.0 ? "+" : "") << i->relativeChange() * 100.0 << '%';
+			}
+
+			stream << '\t';
+			if ( i->pValue() < 1.0)
+			{
+				stream << "p=" << i->pValue();
+			}
+
+			stream << '\n';
+		}
+	}
+}
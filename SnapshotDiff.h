@@ -0,0 +1,150 @@
+#pragma once
+#ifndef PCHDR
+	#include "Benchmark.h"
+	#include "Serializer.h"
+	#include <ostream>
+	#include <string>
+	#include <vector>
+#endif
+
+namespace Info
+{
+	// repeated samples of one probe on one device
+	class Measurement
+	{
+	public:
+		Measurement():
+			iHigherIsBetter( true)
+		{}
+
+		const std::string& device() const { return iDevice; }
+		void setDevice( const std::string& item) { iDevice = item; }
+
+		const std::string& name() const { return iName; }
+		void setName( const std::string& item) { iName = item; }
+
+		// bandwidth is higher-is-better, latency is not
+		bool higherIsBetter() const { return iHigherIsBetter; }
+		void setHigherIsBetter( const bool value) { iHigherIsBetter = value; }
+
+		const std::vector<double>& samples() const { return iSamples; }
+		void setSamples( const std::vector<double>& item) { iSamples = item; }
+
+	private:
+		std::vector<double>	iSamples;
+		std::string			iDevice;
+		std::string			iName;
+		bool				iHigherIsBetter;
+	};
+
+	typedef std::vector<Measurement> MeasurementArray;
+
+	// one line per measurement: device <tab> name <tab> higher|lower <tab> space separated samples
+	bool loadMeasurements( MeasurementArray& measurements, const std::string& path);
+	bool saveMeasurements( const std::string& path, const MeasurementArray& measurements);
+
+	// two-sided p-value of the Mann-Whitney U test (normal approximation with tie correction)
+	double mannWhitney( const std::vector<double>& first, const std::vector<double>& second);
+
+	class Difference
+	{
+	public:
+		enum Kind
+		{
+			kRegression,
+			kImprovement,
+			kChange
+		};
+
+		Difference():
+			iRelativeChange( 0.0),
+			iPValue( 1.0),
+			iScore( 0.0),
+			iKind( kChange)
+		{}
+
+		const std::string& device() const { return iDevice; }
+		void setDevice( const std::string& item) { iDevice = item; }
+
+		const std::string& field() const { return iField; }
+		void setField( const std::string& item) { iField = item; }
+
+		const std::string& before() const { return iBefore; }
+		void setBefore( const std::string& item) { iBefore = item; }
+
+		const std::string& after() const { return iAfter; }
+		void setAfter( const std::string& item) { iAfter = item; }
+
+		// (after - before) / before; 0 for non-numeric fields
+		double relativeChange() const { return iRelativeChange; }
+		void setRelativeChange( const double value) { iRelativeChange = value; }
+
+		// 1 for capability fields, which are exact
+		double pValue() const { return iPValue; }
+		void setPValue( const double value) { iPValue = value; }
+
+		// expected performance impact, used for ranking
+		double score() const { return iScore; }
+		void setScore( const double value) { iScore = value; }
+
+		Kind kind() const { return iKind; }
+		void setKind( const Kind value) { iKind = value; }
+
+	private:
+		std::string	iDevice;
+		std::string	iField;
+		std::string	iBefore;
+		std::string	iAfter;
+		double		iRelativeChange;
+		double		iPValue;
+		double		iScore;
+		Kind		iKind;
+	};
+
+	typedef std::vector<Difference> DifferenceArray;
+
+	// process exit codes of the diff
+	enum DiffResult
+	{
+		drUnchanged,
+		drChanged,		// nothing regressed
+		drRegressed,
+		drInvalid
+	};
+
+	class SnapshotDiff
+	{
+	public:
+		SnapshotDiff():
+			iAlpha( 0.05),
+			iMinimumEffect( 0.02)
+		{}
+
+		// significance level of the measurement test
+		double alpha() const { return iAlpha; }
+		void setAlpha( const double value) { iAlpha = value; }
+
+		// smaller relative changes of measured medians are ignored even when significant
+		double minimumEffect() const { return iMinimumEffect; }
+		void setMinimumEffect( const double value) { iMinimumEffect = value; }
+
+		// devices are matched by PCI location when both snapshots have it, otherwise by name and order
+		bool compare( const void* const before, const size_t beforeSize, const void* const after, const size_t afterSize);
+		void compare( const MeasurementArray& before, const MeasurementArray& after);
+
+		// regressions first, then improvements, then other changes; each by descending score
+		void rank();
+
+		const DifferenceArray& differences() const { return iDifferences; }
+		DiffResult result() const;
+
+	private:
+		void add( const std::string& device, const std::string& field, const ulong before, const ulong after, const double weight, const bool higherIsBetter);
+
+		DifferenceArray	iDifferences;
+		double			iAlpha;
+		double			iMinimumEffect;
+	};
+
+	void write( std::ostream& stream, const DifferenceArray& differences);
+}
@@ -0,0 +1,384 @@
+#include "stdafx.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+
+#ifdef _WIN32
+	#include <windows.h>
+	#define INFO_THREAD_LOCAL __declspec(thread)
+#else
+	#define INFO_THREAD_LOCAL __thread
+#endif
+
+namespace Info
+{
+	namespace Trace
+	{
+		namespace
+		{
+			class Ring
+			{
+			public:
+				enum { capacity = 4096 };
+
+				explicit Ring( const unsigned int thread):
+					head( 0),
+					thread( thread)
+				{}
+
+				Record						records[ capacity];
+				std::atomic<unsigned long long>	head;
+				unsigned int				thread;
+			};
+
+			class Registry
+			{
+			public:
+				std::mutex			mutex;
+				std::vector<Ring*>	rings;
+			};
+
+			// never destroyed so that threads exiting after main do not touch a dead registry
+			Registry& registry()
+			{
+				static Registry* instance = new Registry();
+				return *instance;
+			}
+
+			std::atomic<bool> enabled( false);
+
+			INFO_THREAD_LOCAL Ring* threadRing = nullptr;
+
+			Ring* ring()
+			{
+				if ( !threadRing)
+				{
+					auto& r = registry();
+					std::lock_guard<std::mutex> lock( r.mutex);
+					threadRing = new Ring( static_cast<unsigned int>( r.rings.size() + 1));
+					r.rings.push_back( threadRing);
+				}
+
+				return threadRing;
+			}
+
+			class FieldName
+			{
+			public:
+				unsigned int	field;
+				const char*		name;
+			};
+
+			#define INFO_FIELD( x) { x, #x }
+
+			const FieldName deviceFields[] =
+			{
+				INFO_FIELD( CL_DEVICE_TYPE),
+				INFO_FIELD( CL_DEVICE_VENDOR_ID),
+				INFO_FIELD( CL_DEVICE_MAX_COMPUTE_UNITS),
+				INFO_FIELD( CL_DEVICE_MAX_WORK_ITEM_DIMENSIONS),
+				INFO_FIELD( CL_DEVICE_MAX_WORK_GROUP_SIZE),
+				INFO_FIELD( CL_DEVICE_MAX_WORK_ITEM_SIZES),
+				INFO_FIELD( CL_DEVICE_PREFERRED_VECTOR_WIDTH_CHAR),
+				INFO_FIELD( CL_DEVICE_PREFERRED_VECTOR_WIDTH_SHORT),
+				INFO_FIELD( CL_DEVICE_PREFERRED_VECTOR_WIDTH_INT),
+				INFO_FIELD( CL_DEVICE_PREFERRED_VECTOR_WIDTH_LONG),
+				INFO_FIELD( CL_DEVICE_PREFERRED_VECTOR_WIDTH_FLOAT),
+				INFO_FIELD( CL_DEVICE_PREFERRED_VECTOR_WIDTH_DOUBLE),
+				INFO_FIELD( CL_DEVICE_MAX_CLOCK_FREQUENCY),
+				INFO_FIELD( CL_DEVICE_ADDRESS_BITS),
+				INFO_FIELD( CL_DEVICE_MAX_READ_IMAGE_ARGS),
+				INFO_FIELD( CL_DEVICE_MAX_WRITE_IMAGE_ARGS),
+				INFO_FIELD( CL_DEVICE_MAX_MEM_ALLOC_SIZE),
+				INFO_FIELD( CL_DEVICE_IMAGE2D_MAX_WIDTH),
+				INFO_FIELD( CL_DEVICE_IMAGE2D_MAX_HEIGHT),
+				INFO_FIELD( CL_DEVICE_IMAGE3D_MAX_WIDTH),
+				INFO_FIELD( CL_DEVICE_IMAGE3D_MAX_HEIGHT),
+				INFO_FIELD( CL_DEVICE_IMAGE3D_MAX_DEPTH),
+				INFO_FIELD( CL_DEVICE_IMAGE_SUPPORT),
+				INFO_FIELD( CL_DEVICE_MAX_PARAMETER_SIZE),
+				INFO_FIELD( CL_DEVICE_MAX_SAMPLERS),
+				INFO_FIELD( CL_DEVICE_MEM_BASE_ADDR_ALIGN),
+				INFO_FIELD( CL_DEVICE_MIN_DATA_TYPE_ALIGN_SIZE),
+				INFO_FIELD( CL_DEVICE_SINGLE_FP_CONFIG),
+				INFO_FIELD( CL_DEVICE_GLOBAL_MEM_CACHE_TYPE),
+				INFO_FIELD( CL_DEVICE_GLOBAL_MEM_CACHELINE_SIZE),
+				INFO_FIELD( CL_DEVICE_GLOBAL_MEM_CACHE_SIZE),
+				INFO_FIELD( CL_DEVICE_GLOBAL_MEM_SIZE),
+				INFO_FIELD( CL_DEVICE_MAX_CONSTANT_BUFFER_SIZE),
+				INFO_FIELD( CL_DEVICE_MAX_CONSTANT_ARGS),
+				INFO_FIELD( CL_DEVICE_LOCAL_MEM_TYPE),
+				INFO_FIELD( CL_DEVICE_LOCAL_MEM_SIZE),
+				INFO_FIELD( CL_DEVICE_ERROR_CORRECTION_SUPPORT),
+				INFO_FIELD( CL_DEVICE_PROFILING_TIMER_RESOLUTION),
+				INFO_FIELD( CL_DEVICE_ENDIAN_LITTLE),
+				INFO_FIELD( CL_DEVICE_AVAILABLE),
+				INFO_FIELD( CL_DEVICE_COMPILER_AVAILABLE),
+				INFO_FIELD( CL_DEVICE_EXECUTION_CAPABILITIES),
+				INFO_FIELD( CL_DEVICE_QUEUE_PROPERTIES),
+				INFO_FIELD( CL_DEVICE_NAME),
+				INFO_FIELD( CL_DEVICE_VENDOR),
+				INFO_FIELD( CL_DRIVER_VERSION),
+				INFO_FIELD( CL_DEVICE_PROFILE),
+				INFO_FIELD( CL_DEVICE_VERSION),
+				INFO_FIELD( CL_DEVICE_EXTENSIONS),
+				INFO_FIELD( CL_DEVICE_PLATFORM),
+				INFO_FIELD( CL_DEVICE_DOUBLE_FP_CONFIG),
+				{ 0x1033, "CL_DEVICE_HALF_FP_CONFIG" },
+				INFO_FIELD( CL_DEVICE_PREFERRED_VECTOR_WIDTH_HALF),
+				INFO_FIELD( CL_DEVICE_HOST_UNIFIED_MEMORY),
+				INFO_FIELD( CL_DEVICE_NATIVE_VECTOR_WIDTH_CHAR),
+				INFO_FIELD( CL_DEVICE_NATIVE_VECTOR_WIDTH_SHORT),
+				INFO_FIELD( CL_DEVICE_NATIVE_VECTOR_WIDTH_INT),
+				INFO_FIELD( CL_DEVICE_NATIVE_VECTOR_WIDTH_LONG),
+				INFO_FIELD( CL_DEVICE_NATIVE_VECTOR_WIDTH_FLOAT),
+				INFO_FIELD( CL_DEVICE_NATIVE_VECTOR_WIDTH_DOUBLE),
+				INFO_FIELD( CL_DEVICE_NATIVE_VECTOR_WIDTH_HALF),
+				INFO_FIELD( CL_DEVICE_OPENCL_C_VERSION),
+				INFO_FIELD( CL_DEVICE_LINKER_AVAILABLE),
+				INFO_FIELD( CL_DEVICE_BUILT_IN_KERNELS),
+				INFO_FIELD( CL_DEVICE_IMAGE_MAX_BUFFER_SIZE),
+				INFO_FIELD( CL_DEVICE_IMAGE_MAX_ARRAY_SIZE),
+				INFO_FIELD( CL_DEVICE_PARENT_DEVICE),
+				INFO_FIELD( CL_DEVICE_PARTITION_MAX_SUB_DEVICES),
+				INFO_FIELD( CL_DEVICE_PARTITION_PROPERTIES),
+				INFO_FIELD( CL_DEVICE_PARTITION_AFFINITY_DOMAIN),
+				INFO_FIELD( CL_DEVICE_PARTITION_TYPE),
+				INFO_FIELD( CL_DEVICE_REFERENCE_COUNT),
+				INFO_FIELD( CL_DEVICE_PREFERRED_INTEROP_USER_SYNC),
+				INFO_FIELD( CL_DEVICE_PRINTF_BUFFER_SIZE),
+				{ 0x4008, "CL_DEVICE_PCI_BUS_ID_NV" },
+				{ 0x4009, "CL_DEVICE_PCI_SLOT_ID_NV" },
+				{ 0x400A, "CL_DEVICE_PCI_DOMAIN_ID_NV" },
+				{ 0x4037, "CL_DEVICE_TOPOLOGY_AMD" },
+				{ 0x410F, "CL_DEVICE_PCI_BUS_INFO_KHR" }
+			};
+
+			const FieldName platformFields[] =
+			{
+				INFO_FIELD( CL_PLATFORM_PROFILE),
+				INFO_FIELD( CL_PLATFORM_VERSION),
+				INFO_FIELD( CL_PLATFORM_NAME),
+				INFO_FIELD( CL_PLATFORM_VENDOR),
+				INFO_FIELD( CL_PLATFORM_EXTENSIONS)
+			};
+
+			#undef INFO_FIELD
+
+			unsigned long long key( const Kind kind, const unsigned int field)
+			{
+				return static_cast<unsigned long long>( kind) << 32 | field;
+			}
+		}
+
+		Histogram::Histogram():
+			iCount( 0),
+			iTotal( 0),
+			iMax( 0)
+		{
+			for ( int i = 0; i < bucketCount; ++i)
+			{
+				iBuckets[ i] = 0;
+			}
+		}
+
+		void Histogram::add( const unsigned long long duration)
+		{
+			int bucket = 0;
+			while ( bucket < bucketCount - 1 && ( 1ULL << bucket) < duration)
+			{
+				++bucket;
+			}
+
+			++iBuckets[ bucket];
+			++iCount;
+			iTotal += duration;
+			if ( duration > iMax)
+			{
+				iMax = duration;
+			}
+		}
+
+		unsigned long long Histogram::quantile( const double q) const
+		{
+			const auto target = static_cast<unsigned long long>( q * iCount);
+			unsigned long long seen = 0;
+			for ( int i = 0; i < bucketCount; ++i)
+			{
+				seen += iBuckets[ i];
+				if ( seen > target)
+				{
+					return std::min( 1ULL << i, iMax);
+				}
+			}
+
+			return iMax;
+		}
+
+		void setEnabled( const bool value)
+		{
+			enabled = value;
+		}
+
+		bool isEnabled()
+		{
+			return enabled.load( std::memory_order_relaxed);
+		}
+
+		unsigned long long now()
+		{
+		#ifdef _WIN32
+			static LARGE_INTEGER frequency = { 0 };
+			if ( !frequency.QuadPart)
+			{
+				QueryPerformanceFrequency( &frequency);
+			}
+
+			LARGE_INTEGER counter;
+			QueryPerformanceCounter( &counter);
+			return static_cast<unsigned long long>( counter.QuadPart / frequency.QuadPart * 1000000000ULL + counter.QuadPart % frequency.QuadPart * 1000000000ULL / frequency.QuadPart);
+		#else
+			return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch()).count();
+		#endif
+		}
+
+		void record( const Kind kind, const void* const object, const unsigned int field, const int status, const unsigned long long start, const unsigned long long end)
+		{
+			auto r = ring();
+			const auto index = r->head.load( std::memory_order_relaxed);
+			auto& item = r->records[ index % Ring::capacity];
+			item.start = start;
+			item.duration = end - start;
+			item.object = object;
+			item.field = field;
+			item.thread = r->thread;
+			item.status = status;
+			item.kind = kind;
+			r->head.store( index + 1, std::memory_order_release);
+		}
+
+		void collect( RecordArray& records)
+		{
+			records.clear();
+
+			auto& r = registry();
+			std::lock_guard<std::mutex> lock( r.mutex);
+			for ( auto i = r.rings.begin(); i != r.rings.end(); ++i)
+			{
+				const auto& ring = **i;
+				const auto head = ring.head.load( std::memory_order_acquire);
+				const auto first = head > Ring::capacity ? head - Ring::capacity : 0;
+				const auto offset = records.size();
+				for ( auto index = first; index < head; ++index)
+				{
+					records.push_back( ring.records[ index % Ring::capacity]);
+				}
+
+				// drop entries the owning thread overwrote while they were copied
+				const auto after = ring.head.load( std::memory_order_acquire);
+				if ( after + 1 > first + Ring::capacity)
+				{
+					const auto overwritten = std::min<unsigned long long>( after + 1 - first - Ring::capacity, head - first);
+					records.erase( records.begin() + offset, records.begin() + offset + static_cast<size_t>( overwritten));
+				}
+			}
+		}
+
+		void clear()
+		{
+			auto& r = registry();
+			std::lock_guard<std::mutex> lock( r.mutex);
+			for ( auto i = r.rings.begin(); i != r.rings.end(); ++i)
+			{
+				( *i)->head.store( 0, std::memory_order_release);
+			}
+		}
+
+		void histograms( HistogramMap& result, const RecordArray& records)
+		{
+			result.clear();
+			for ( auto i = records.begin(); i != records.end(); ++i)
+			{
+				result[ key( i->kind, i->field)].add( i->duration);
+			}
+		}
+
+		const char* fieldName( const Kind kind, const unsigned int field)
+		{
+			const FieldName* table = kind == kDevice ? deviceFields : platformFields;
+			const size_t count = kind == kDevice ? sizeof(deviceFields) / sizeof(deviceFields[ 0]) : sizeof(platformFields) / sizeof(platformFields[ 0]);
+			for ( size_t i = 0; i < count; ++i)
+			{
+				if ( table[ i].field == field)
+				{
+					return table[ i].name;
+				}
+			}
+
+			return nullptr;
+		}
+
+		void writeChromeTrace( std::ostream& stream, const RecordArray& records)
+		{
+			stream << "{\"traceEvents\":[";
+			const auto precision = stream.precision( 3);
+			const auto flags = stream.setf( std::ios::fixed, std::ios::floatfield);
+			for ( size_t i = 0; i < records.size(); ++i)
+			{
+				const auto& item = records[ i];
+				const auto name = fieldName( item.kind, item.field);
+
+				stream << ( i ? ",\n" : "\n") << "{\"name\":\"";
+				if ( name)
+				{
+					stream << name;
+				}
+				else
+				{
+					stream << "0x" << std::hex << item.field << std::dec;
+				}
+
+				stream << "\",\"cat\":\"" << ( item.kind == kDevice ? "clGetDeviceInfo" : "clGetPlatformInfo") << "\",\"ph\":\"X\"";
+				stream << ",\"ts\":" << item.start / 1000.0 << ",\"dur\":" << item.duration / 1000.0;
+				stream << ",\"pid\":1,\"tid\":" << item.thread;
+				stream << ",\"args\":{\"object\":\"" << item.object << "\",\"status\":" << item.status << "}}";
+			}
+
+			stream.flags( flags);
+			stream.precision( precision);
+			stream << "\n],\"displayTimeUnit\":\"ns\"}\n";
+		}
+
+		void writeHistograms( std::ostream& stream, const HistogramMap& histograms)
+		{
+			stream << std::left << std::setw( 44) << "field" << std::right << std::setw( 8) << "calls" << std::setw( 12) << "mean ns" << std::setw( 12) << "p50 ns" << std::setw( 12) << "p99 ns" << std::setw( 12) << "max ns" << '\n';
+			for ( auto i = histograms.begin(); i != histograms.end(); ++i)
+			{
+				const auto kind = static_cast<Kind>( i->first >> 32);
+				const auto field = static_cast<unsigned int>( i->first);
+				const auto name = fieldName( kind, field);
+				const auto& h = i->second;
+
+				std::string label;
+				if ( name)
+				{
+					label = name;
+				}
+				else
+				{
+					std::ostringstream text;
+					text << "0x" << std::hex << field;
+					label = text.str();
+				}
+
+				stream << std::left << std::setw( 44) << label << std::right << std::setw( 8) << h.count();
+				stream << std::setw( 12) << ( h.count() ? h.total() / h.count() : 0);
+				stream << std::setw( 12) << h.quantile( 0.5) << std::setw( 12) << h.quantile( 0.99) << std::setw( 12) << h.max() << '\n';
+			}
+		}
+	}
+}
@@ -0,0 +1,113 @@
+#pragma once
+#ifndef PCHDR
+	#include <CL/cl.h>
+	#include <map>
+	#include <ostream>
+	#include <string>
+	#include <vector>
+#endif
+
+// Define INFO_NO_TRACE to compile the query instrumentation out entirely.
+// Otherwise it is present but off until Trace::setEnabled( true).
+
+namespace Info
+{
+	namespace Trace
+	{
+		enum Kind
+		{
+			kDevice,
+			kPlatform
+		};
+
+		class Record
+		{
+		public:
+			unsigned long long	start;		// ns, Trace::now() clock
+			unsigned long long	duration;	// ns
+			const void*			object;		// cl_device_id or cl_platform_id
+			unsigned int		field;
+			unsigned int		thread;
+			int					status;
+			Kind				kind;
+		};
+
+		typedef std::vector<Record> RecordArray;
+
+		class Histogram
+		{
+		public:
+			enum { bucketCount = 48 };
+
+			Histogram();
+
+			void add( const unsigned long long duration);
+
+			unsigned long long count() const { return iCount; }
+			unsigned long long total() const { return iTotal; }
+			unsigned long long max() const { return iMax; }
+
+			// upper bound of the bucket holding the given quantile, in ns
+			unsigned long long quantile( const double q) const;
+
+		private:
+			unsigned long long iBuckets[ bucketCount];
+			unsigned long long iCount;
+			unsigned long long iTotal;
+			unsigned long long iMax;
+		};
+
+		// keyed by Kind << 32 | field
+		typedef std::map<unsigned long long, Histogram> HistogramMap;
+
+		void setEnabled( const bool value);
+		bool isEnabled();
+
+		// monotonic nanoseconds
+		unsigned long long now();
+
+		void record( const Kind kind, const void* const object, const unsigned int field, const int status, const unsigned long long start, const unsigned long long end);
+
+		// copies the records still held by every thread's ring, oldest first per thread
+		void collect( RecordArray& records);
+
+		// only while no instrumented query is running
+		void clear();
+
+		void histograms( HistogramMap& result, const RecordArray& records);
+		const char* fieldName( const Kind kind, const unsigned int field);
+
+		void writeChromeTrace( std::ostream& stream, const RecordArray& records);
+		void writeHistograms( std::ostream& stream, const HistogramMap& histograms);
+	}
+
+	inline cl_int getDeviceInfo( const cl_device_id id, const cl_uint field, const size_t size, void* const value, size_t* const sizeReturned)
+	{
+	#ifndef INFO_NO_TRACE
+		if ( Trace::isEnabled())
+		{
+			const auto start = Trace::now();
+			const auto error = clGetDeviceInfo( id, field, size, value, sizeReturned);
+			Trace::record( Trace::kDevice, id, field, error, start, Trace::now());
+			return error;
+		}
+	#endif
+
+		return clGetDeviceInfo( id, field, size, value, sizeReturned);
+	}
+
+	inline cl_int getPlatformInfo( const cl_platform_id id, const cl_uint field, const size_t size, void* const value, size_t* const sizeReturned)
+	{
+	#ifndef INFO_NO_TRACE
+		if ( Trace::isEnabled())
+		{
+			const auto start = Trace::now();
+			const auto error = clGetPlatformInfo( id, field, size, value, sizeReturned);
+			Trace::record( Trace::kPlatform, id, field, error, start, Trace::now());
+			return error;
+		}
+	#endif
+
+		return clGetPlatformInfo( id, field, size, value, sizeReturned);
+	}
+}
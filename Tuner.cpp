@@ -0,0 +1,403 @@
+#include "stdafx.h"
+#include "Tuner.h"
+#include "File.h"
+#include "Fingerprint.h"
+#include "ProgramCache.h"
+#include <algorithm>
+#include <sstream>
+
+namespace Info
+{
+	namespace
+	{
+		std::string sanitize( std::string text)
+		{
+			std::replace( text.begin(), text.end(), '\t', ' ');
+			std::replace( text.begin(), text.end(), '\n', ' ');
+			std::replace( text.begin(), text.end(), '\r', ' ');
+			return text;
+		}
+	}
+
+	TuningStore::TuningStore( const std::string& path):
+		iPath( path)
+	{
+		load();
+	}
+
+	bool TuningStore::find( const std::string& key, TuningConfiguration& item) const
+	{
+		auto i = iEntries.find( key);
+		if ( i == iEntries.end())
+		{
+			return false;
+		}
+
+		item = i->second;
+		return true;
+	}
+
+	void TuningStore::set( const std::string& key, const TuningConfiguration& item)
+	{
+		iEntries[ key] = item;
+	}
+
+	void TuningStore::load()
+	{
+		iEntries.clear();
+		std::ifstream file( iPath.c_str());
+		std::string line;
+		while ( std::getline( file, line))
+		{
+			std::istringstream stream( line);
+			std::string key, widthText, timeText, localText;
+			if ( !std::getline( stream, key, '\t') || !std::getline( stream, widthText, '\t') || !std::getline( stream, timeText, '\t'))
+			{
+				continue;
+			}
+
+			std::getline( stream, localText);
+
+			TuningConfiguration item;
+			item.setVectorWidth( static_cast<uint>( strtoul( widthText.c_str(), nullptr, 10)));
+			item.setTime( strtod( timeText.c_str(), nullptr));
+
+			{
+				Device::SizeTArray local;
+				std::istringstream sizes( localText);
+				size_t value;
+				while ( sizes >> value)
+				{
+					local.push_back( value);
+				}
+
+				item.setLocalSize( local);
+			}
+
+			iEntries[ key] = item;
+		}
+	}
+
+	void TuningStore::save() const
+	{
+		std::ostringstream stream;
+		for ( auto i = iEntries.begin(); i != iEntries.end(); ++i)
+		{
+			stream << i->first << '\t' << i->second.vectorWidth() << '\t' << i->second.time() << '\t';
+			const auto& local = i->second.localSize();
+			for ( size_t d = 0; d < local.size(); ++d)
+			{
+				stream << ( d ? " " : "") << local[ d];
+			}
+
+			stream << '\n';
+		}
+
+		const auto text = stream.str();
+		File::writeAtomically( iPath, text.data(), text.size());
+	}
+
+	std::string TuningStore::key( const Device& device, const TuningTask& task)
+	{
+		std::ostringstream stream;
+		stream << device.name() << '|' << device.driverVersion() << '|' << task.kernelName() << '|' << task.buildOptions() << '|' << task.vectorType() << '|' << Hash().add( task.source()).text() << '|';
+		for ( size_t d = 0; d < task.globalSize().size(); ++d)
+		{
+			stream << ( d ? "x" : "") << task.globalSize()[ d];
+		}
+
+		return sanitize( stream.str());
+	}
+
+	Tuner::Tuner( const cl_context context, const cl_device_id id, const Device& device, TuningStore& store):
+		iDevice( device),
+		iStore( store),
+		iBenchmark( device.profilingTimerResolution()),
+		iContext( context),
+		iId( id),
+		iQueue( nullptr),
+		iPruneFactor( 1.5),
+		iRepetitions( 5),
+		iPatience( 0)
+	{
+		cl_int error = CL_SUCCESS;
+		iQueue = clCreateCommandQueue( iContext, iId, CL_QUEUE_PROFILING_ENABLE, &error);
+		if ( error)
+		{
+			throw ApiException( "clCreateCommandQueue", error);
+		}
+
+		// a search times many candidates, so each gets a shorter budget than a standalone probe
+		BenchmarkSettings settings;
+		settings.setMaxSamples( 50);
+		settings.setTimeLimit( 0.5);
+		settings.setWarmupLimit( 6);
+		iBenchmark.setSettings( settings);
+	}
+
+	Tuner::~Tuner()
+	{
+		clReleaseCommandQueue( iQueue);
+	}
+
+	VectorWidthArray Tuner::vectorWidths( const Device& device, const VectorType type)
+	{
+		uint limit = 1;
+		if ( static_cast<size_t>( type) < device.nativeVectorWidths().size())
+		{
+			limit = std::max( limit, device.nativeVectorWidths()[ type]);
+		}
+
+		if ( static_cast<size_t>( type) < device.preferredVectorWidths().size())
+		{
+			limit = std::max( limit, device.preferredVectorWidths()[ type]);
+		}
+
+		VectorWidthArray widths;
+		for ( uint width = 1; width <= limit && width <= 16; width *= 2)
+		{
+			widths.push_back( width);
+		}
+
+		return widths;
+	}
+
+	TuningConfiguration Tuner::tune( const TuningTask& task)
+	{
+		const auto key = TuningStore::key( iDevice, task);
+		TuningConfiguration best;
+		if ( iStore.find( key, best))
+		{
+			return best;
+		}
+
+		best = search( task);
+		if ( best.isValid())
+		{
+			iStore.set( key, best);
+			iStore.save();
+		}
+
+		return best;
+	}
+
+	TuningConfiguration Tuner::search( const TuningTask& task)
+	{
+		auto widths = task.vectorWidths();
+		if ( widths.empty())
+		{
+			widths = vectorWidths( iDevice, task.vectorType());
+		}
+
+		TuningConfiguration best;
+		for ( auto i = widths.begin(); i != widths.end(); ++i)
+		{
+			searchWidth( best, task, *i);
+		}
+
+		return best;
+	}
+
+	void Tuner::candidates( SizeTArrayList& list, const Device::SizeTArray& global, const size_t kernelMaxWorkGroupSize) const
+	{
+		const auto dimensions = std::min<size_t>( global.size(), 3);
+		const auto maxGroupSize = std::min( iDevice.maxWorkGroupSize(), kernelMaxWorkGroupSize);
+
+		SizeTArrayList perDimension( dimensions);
+		for ( size_t d = 0; d < dimensions; ++d)
+		{
+			const auto maxItems = d < iDevice.maxWorkItemSizes().size() ? iDevice.maxWorkItemSizes()[ d] : maxGroupSize;
+			for ( size_t size = 1; size <= maxItems && size <= global[ d]; size *= 2)
+			{
+				if ( global[ d] % size == 0)
+				{
+					perDimension[ d].push_back( size);
+				}
+			}
+		}
+
+		list.clear();
+		list.push_back( Device::SizeTArray());
+
+		// a dimension without a valid size leaves only the driver's choice
+		for ( size_t d = 0; d < dimensions; ++d)
+		{
+			if ( perDimension[ d].empty())
+			{
+				return;
+			}
+		}
+
+		Device::SizeTArray local( dimensions, 1);
+		Device::SizeTArray index( dimensions, 0);
+		for ( ; dimensions; )
+		{
+			size_t groupSize = 1;
+			for ( size_t d = 0; d < dimensions; ++d)
+			{
+				local[ d] = perDimension[ d][ index[ d]];
+				groupSize *= local[ d];
+			}
+
+			if ( groupSize <= maxGroupSize)
+			{
+				list.push_back( local);
+			}
+
+			size_t d = 0;
+			for ( ; d < dimensions && ++index[ d] == perDimension[ d].size(); ++d)
+			{
+				index[ d] = 0;
+			}
+
+			if ( d == dimensions)
+			{
+				break;
+			}
+		}
+
+		// largest groups first so that pruning has a good reference early
+		std::stable_sort( list.begin() + 1, list.end(), []( const Device::SizeTArray& a, const Device::SizeTArray& b)
+		{
+			size_t sizeA = 1, sizeB = 1;
+			for ( size_t d = 0; d < a.size(); ++d)
+			{
+				sizeA *= a[ d];
+				sizeB *= b[ d];
+			}
+
+			return sizeA > sizeB;
+		});
+	}
+
+	cl_int Tuner::measure( const cl_kernel kernel, const Device::SizeTArray& global, const Device::SizeTArray& local, double& nanoseconds) const
+	{
+		const auto start = Trace::now();
+		cl_event event = nullptr;
+		auto error = clEnqueueNDRangeKernel( iQueue, kernel, static_cast<cl_uint>( global.size()), nullptr, &global[ 0], local.empty() ? nullptr : &local[ 0], 0, nullptr, &event);
+		if ( error)
+		{
+			return error;
+		}
+
+		bool fromDevice;
+		if ( !iBenchmark.time( nanoseconds, fromDevice, event, start))
+		{
+			error = CL_INVALID_EVENT;
+		}
+
+		clReleaseEvent( event);
+		return error;
+	}
+
+	void Tuner::searchWidth( TuningConfiguration& best, const TuningTask& task, const uint vectorWidth)
+	{
+		auto global = task.globalSize();
+		if ( global.empty() || global[ 0] % vectorWidth)
+		{
+			return;
+		}
+
+		global[ 0] /= vectorWidth;
+
+		std::string options;
+		{
+			std::ostringstream stream;
+			stream << task.buildOptions() << " -D VECTOR_WIDTH=" << vectorWidth;
+			options = stream.str();
+		}
+
+		cl_int error = CL_SUCCESS;
+		const char* source = task.source().c_str();
+		const size_t sourceSize = task.source().size();
+		auto program = clCreateProgramWithSource( iContext, 1, &source, &sourceSize, &error);
+		if ( error)
+		{
+			throw ApiException( "clCreateProgramWithSource", error);
+		}
+
+		error = clBuildProgram( program, 1, &iId, options.c_str(), nullptr, nullptr);
+		if ( error)
+		{
+			std::cerr << buildLog( program, iId) << '\n';
+			clReleaseProgram( program);
+			throw ApiException( "clBuildProgram", error);
+		}
+
+		auto kernel = clCreateKernel( program, task.kernelName().c_str(), &error);
+		for ( size_t i = 0; !error && i < task.arguments().size(); ++i)
+		{
+			const auto& argument = task.arguments()[ i];
+			error = clSetKernelArg( kernel, static_cast<cl_uint>( i), argument.size(), argument.value());
+		}
+
+		size_t kernelMaxWorkGroupSize = iDevice.maxWorkGroupSize();
+		if ( !error)
+		{
+			error = clGetKernelWorkGroupInfo( kernel, iId, CL_KERNEL_WORK_GROUP_SIZE, sizeof(size_t), &kernelMaxWorkGroupSize, nullptr);
+		}
+
+		if ( error)
+		{
+			if ( kernel)
+			{
+				clReleaseKernel( kernel);
+			}
+
+			clReleaseProgram( program);
+			throw ApiException( "clCreateKernel", error);
+		}
+
+		{
+			double warmUp;
+			measure( kernel, global, Device::SizeTArray(), warmUp);
+		}
+
+		SizeTArrayList list;
+		candidates( list, global, kernelMaxWorkGroupSize);
+
+		uint sinceImprovement = 0;
+		for ( auto i = list.begin(); i != list.end(); ++i)
+		{
+			double time;
+			if ( measure( kernel, global, *i, time))
+			{
+				continue;
+			}
+
+			const bool pruned = best.isValid() && time > best.time() * iPruneFactor;
+			if ( !pruned)
+			{
+				auto settings = iBenchmark.settings();
+				settings.setMinSamples( iRepetitions);
+
+				Benchmark benchmark( iDevice.profilingTimerResolution());
+				benchmark.setSettings( settings);
+
+				const auto& local = *i;
+				const auto result = benchmark.run( [&]() -> cl_event
+				{
+					cl_event event = nullptr;
+					return clEnqueueNDRangeKernel( iQueue, kernel, static_cast<cl_uint>( global.size()), nullptr, &global[ 0], local.empty() ? nullptr : &local[ 0], 0, nullptr, &event) ? nullptr : event;
+				});
+
+				time = result.isValid() ? result.median() : time;
+			}
+
+			if ( !pruned && ( !best.isValid() || time < best.time()))
+			{
+				best.setLocalSize( *i);
+				best.setVectorWidth( vectorWidth);
+				best.setTime( std::max( time, 1.0));
+				sinceImprovement = 0;
+			}
+			else if ( iPatience && ++sinceImprovement >= iPatience)
+			{
+				break;
+			}
+		}
+
+		clReleaseKernel( kernel);
+		clReleaseProgram( program);
+	}
+}
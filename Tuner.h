@@ -0,0 +1,175 @@
+#pragma once
+#ifndef PCHDR
+	#include "Benchmark.h"
+	#include "OpenCLInfo.h"
+	#include <map>
+	#include <string>
+	#include <vector>
+#endif
+
+namespace Info
+{
+	class KernelArgument
+	{
+	public:
+		KernelArgument():
+			iSize( 0)
+		{}
+
+		KernelArgument( const void* const value, const size_t size):
+			iValue( static_cast<const byte*>( value), static_cast<const byte*>( value) + size),
+			iSize( size)
+		{}
+
+		// __local argument of the given size
+		explicit KernelArgument( const size_t localSize):
+			iSize( localSize)
+		{}
+
+		const void* value() const { return iValue.empty() ? nullptr : &iValue[ 0]; }
+		size_t size() const { return iSize; }
+
+	private:
+		std::vector<byte>	iValue;
+		size_t				iSize;
+	};
+
+	typedef std::vector<KernelArgument> KernelArgumentArray;
+
+	class TuningTask
+	{
+	public:
+		TuningTask():
+			iVectorType( vtFloat)
+		{}
+
+		const std::string& source() const { return iSource; }
+		void setSource( const std::string& item) { iSource = item; }
+
+		const std::string& kernelName() const { return iKernelName; }
+		void setKernelName( const std::string& item) { iKernelName = item; }
+
+		const std::string& buildOptions() const { return iBuildOptions; }
+		void setBuildOptions( const std::string& item) { iBuildOptions = item; }
+
+		const KernelArgumentArray& arguments() const { return iArguments; }
+		void setArguments( const KernelArgumentArray& item) { iArguments = item; }
+
+		// global size of the scalar variant; dimension 0 is divided by the vector width
+		const Device::SizeTArray& globalSize() const { return iGlobalSize; }
+		void setGlobalSize( const Device::SizeTArray& item) { iGlobalSize = item; }
+
+		VectorType vectorType() const { return iVectorType; }
+		void setVectorType( const VectorType value) { iVectorType = value; }
+
+		// explicit vector widths to try; derived from the device when empty
+		const VectorWidthArray& vectorWidths() const { return iVectorWidths; }
+		void setVectorWidths( const VectorWidthArray& item) { iVectorWidths = item; }
+
+	private:
+		KernelArgumentArray	iArguments;
+		Device::SizeTArray	iGlobalSize;
+		VectorWidthArray	iVectorWidths;
+		std::string			iSource;
+		std::string			iKernelName;
+		std::string			iBuildOptions;
+		VectorType			iVectorType;
+	};
+
+	class TuningConfiguration
+	{
+	public:
+		TuningConfiguration():
+			iTime( 0.0),
+			iVectorWidth( 1)
+		{}
+
+		// empty local size means the driver chooses
+		const Device::SizeTArray& localSize() const { return iLocalSize; }
+		void setLocalSize( const Device::SizeTArray& item) { iLocalSize = item; }
+
+		uint vectorWidth() const { return iVectorWidth; }
+		void setVectorWidth( const uint value) { iVectorWidth = value; }
+
+		// nanoseconds
+		double time() const { return iTime; }
+		void setTime( const double value) { iTime = value; }
+
+		bool isValid() const { return iTime > 0.0; }
+
+	private:
+		Device::SizeTArray	iLocalSize;
+		double				iTime;
+		uint				iVectorWidth;
+	};
+
+	class TuningStore
+	{
+	public:
+		explicit TuningStore( const std::string& path);
+
+		bool find( const std::string& key, TuningConfiguration& item) const;
+		void set( const std::string& key, const TuningConfiguration& item);
+
+		void load();
+		void save() const;
+
+		// device, kernel, options, source hash and global size
+		static std::string key( const Device& device, const TuningTask& task);
+
+	private:
+		typedef std::map<std::string, TuningConfiguration> Map;
+
+		Map			iEntries;
+		std::string	iPath;
+	};
+
+	class Tuner
+	{
+	public:
+		Tuner( const cl_context context, const cl_device_id id, const Device& device, TuningStore& store);
+		~Tuner();
+
+		// returns the cached configuration when present, otherwise searches, stores and saves
+		TuningConfiguration tune( const TuningTask& task);
+		TuningConfiguration search( const TuningTask& task);
+
+		// minimum timed runs of a candidate that survives pruning
+		uint repetitions() const { return iRepetitions; }
+		void setRepetitions( const uint value) { iRepetitions = value; }
+
+		// repetition, warm-up and outlier limits of the candidate timing
+		const BenchmarkSettings& benchmarkSettings() const { return iBenchmark.settings(); }
+		void setBenchmarkSettings( const BenchmarkSettings& item) { iBenchmark.setSettings( item); }
+
+		// a candidate whose first run is slower than pruneFactor * best is dropped
+		double pruneFactor() const { return iPruneFactor; }
+		void setPruneFactor( const double value) { iPruneFactor = value; }
+
+		// stop after this many consecutive candidates without improvement; 0 disables
+		uint patience() const { return iPatience; }
+		void setPatience( const uint value) { iPatience = value; }
+
+		static VectorWidthArray vectorWidths( const Device& device, const VectorType type);
+
+	private:
+		Tuner( const Tuner&);
+		Tuner& operator=( const Tuner&);
+
+		typedef std::vector<Device::SizeTArray> SizeTArrayList;
+
+		void candidates( SizeTArrayList& list, const Device::SizeTArray& global, const size_t kernelMaxWorkGroupSize) const;
+		cl_int measure( const cl_kernel kernel, const Device::SizeTArray& global, const Device::SizeTArray& local, double& nanoseconds) const;
+		void searchWidth( TuningConfiguration& best, const TuningTask& task, const uint vectorWidth);
+
+		const Device&		iDevice;
+		TuningStore&		iStore;
+		Benchmark			iBenchmark;
+		cl_context			iContext;
+		cl_device_id		iId;
+		cl_command_queue	iQueue;
+		double				iPruneFactor;
+		uint				iRepetitions;
+		uint				iPatience;
+	};
+}
@@ -0,0 +1,199 @@
+#include "stdafx.h"
+#include "Watch.h"
+#include <algorithm>
+#include <chrono>
+
+#ifndef CL_DEVICE_GLOBAL_FREE_MEMORY_AMD
+	#define CL_DEVICE_GLOBAL_FREE_MEMORY_AMD 0x4039
+#endif
+
+namespace Info
+{
+	namespace
+	{
+		const uint volatileFields[] =
+		{
+			CL_DEVICE_AVAILABLE,
+			CL_DEVICE_REFERENCE_COUNT,
+			CL_DEVICE_GLOBAL_FREE_MEMORY_AMD
+		};
+
+		bool hasExtension( const Device& device, const char* const name)
+		{
+			const auto& extensions = device.extensions();
+			return std::find( extensions.begin(), extensions.end(), std::string( name)) != extensions.end();
+		}
+	}
+
+	Volatility volatility( const uint field)
+	{
+		const auto end = volatileFields + sizeof(volatileFields) / sizeof(volatileFields[ 0]);
+		return std::find( volatileFields, end, field) != end ? vVolatile : vImmutable;
+	}
+
+	void write( std::ostream& stream, const ChangeArray& changes)
+	{
+		for ( auto i = changes.begin(); i != changes.end(); ++i)
+		{
+			const auto name = Trace::fieldName( Trace::kDevice, i->field());
+			stream << i->device() << ' ';
+			if ( name)
+			{
+				stream << name;
+			}
+			else
+			{
+				stream << "0x" << std::hex << i->field() << std::dec;
+			}
+
+			stream << ' ' << i->before() << ' ' << i->after() << '\n';
+		}
+	}
+
+	Watch::Watch( const DeviceInstanceArray& devices, WatchListener& listener):
+		iListener( listener),
+		iCpuBudget( 0.001),
+		iInterval( 1000),
+		iEffectiveInterval( 1000),
+		iProbeTime( 0),
+		iStopping( false)
+	{
+		for ( size_t d = 0; d < devices.size(); ++d)
+		{
+			const auto id = devices[ d].id();
+			iIds.push_back( id);
+
+			for ( size_t f = 0; f < sizeof(volatileFields) / sizeof(volatileFields[ 0]); ++f)
+			{
+				if ( volatileFields[ f] == CL_DEVICE_GLOBAL_FREE_MEMORY_AMD && !( devices[ d].record() && hasExtension( *devices[ d].record(), "cl_amd_device_attribute_query")))
+				{
+					continue;
+				}
+
+				Field field;
+				field.device = d;
+				field.field = volatileFields[ f];
+				if ( readVolatile( field.value, id, field.field))
+				{
+					iFields.push_back( field);
+				}
+			}
+		}
+	}
+
+	Watch::~Watch()
+	{
+		stop();
+	}
+
+	bool Watch::readVolatile( ulong& value, const cl_device_id id, const uint field)
+	{
+		switch ( field)
+		{
+			case CL_DEVICE_AVAILABLE:
+			{
+				cl_bool available;
+				if ( getDeviceInfo( id, field, sizeof(available), &available, nullptr))
+				{
+					return false;
+				}
+
+				value = available != 0;
+				return true;
+			}
+
+			case CL_DEVICE_GLOBAL_FREE_MEMORY_AMD:
+			{
+				// total free and largest free block, in KB
+				size_t free[ 2];
+				if ( getDeviceInfo( id, field, sizeof(free), free, nullptr))
+				{
+					return false;
+				}
+
+				value = static_cast<ulong>( free[ 0]) * 1024;
+				return true;
+			}
+
+			default:
+			{
+				cl_uint item;
+				if ( getDeviceInfo( id, field, sizeof(item), &item, nullptr))
+				{
+					return false;
+				}
+
+				value = item;
+				return true;
+			}
+		}
+	}
+
+	void Watch::poll( ChangeArray& changes)
+	{
+		changes.clear();
+		iProbeTime = std::chrono::steady_clock::duration( 0);
+		for ( auto i = iFields.begin(); i != iFields.end(); ++i)
+		{
+			ulong value;
+			const auto start = std::chrono::steady_clock::now();
+			const auto read = readVolatile( value, iIds[ i->device], i->field);
+			iProbeTime += std::chrono::steady_clock::now() - start;
+			if ( read && value != i->value)
+			{
+				changes.push_back( Change( i->device, i->field, i->value, value));
+				i->value = value;
+			}
+		}
+	}
+
+	void Watch::start()
+	{
+		if ( !iThread.joinable())
+		{
+			iStopping = false;
+			iThread = std::thread( &Watch::work, this);
+		}
+	}
+
+	void Watch::stop()
+	{
+		{
+			std::lock_guard<std::mutex> lock( iMutex);
+			iStopping = true;
+		}
+
+		iWake.notify_all();
+		if ( iThread.joinable())
+		{
+			iThread.join();
+		}
+	}
+
+	void Watch::work()
+	{
+		ChangeArray changes;
+		for ( ;;)
+		{
+			poll( changes);
+			if ( !changes.empty())
+			{
+				iListener.changed( changes);
+			}
+
+			// only the reads count, so time spent descheduled between them does not stretch the interval
+			const auto probe = std::chrono::duration<double, std::milli>( iProbeTime).count();
+			const double cpuBudget = iCpuBudget;
+			const unsigned int minimum = iInterval;
+			const auto budgeted = cpuBudget > 0.0 ? static_cast<unsigned int>( probe / cpuBudget) : 0;
+			const auto interval = std::max( minimum, budgeted);
+			iEffectiveInterval = interval;
+
+			std::unique_lock<std::mutex> lock( iMutex);
+			if ( iWake.wait_for( lock, std::chrono::milliseconds( interval), [this] { return iStopping; }))
+			{
+				return;
+			}
+		}
+	}
+}
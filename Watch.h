@@ -0,0 +1,120 @@
+#pragma once
+#ifndef PCHDR
+	#include "Discovery.h"
+	#include <atomic>
+	#include <chrono>
+	#include <condition_variable>
+	#include <mutex>
+	#include <ostream>
+	#include <thread>
+	#include <vector>
+#endif
+
+namespace Info
+{
+	enum Volatility
+	{
+		vImmutable,
+		vVolatile
+	};
+
+	Volatility volatility( const uint field);
+
+	class Change
+	{
+	public:
+		Change():
+			iDevice( 0),
+			iField( 0),
+			iBefore( 0),
+			iAfter( 0)
+		{}
+
+		Change( const size_t device, const uint field, const ulong before, const ulong after):
+			iDevice( device),
+			iField( field),
+			iBefore( before),
+			iAfter( after)
+		{}
+
+		// index into the watched device array
+		size_t device() const { return iDevice; }
+		uint field() const { return iField; }
+		ulong before() const { return iBefore; }
+		ulong after() const { return iAfter; }
+
+	private:
+		size_t	iDevice;
+		uint	iField;
+		ulong	iBefore;
+		ulong	iAfter;
+	};
+
+	typedef std::vector<Change> ChangeArray;
+
+	// one line per change: device field before after
+	void write( std::ostream& stream, const ChangeArray& changes);
+
+	class WatchListener
+	{
+	public:
+		virtual ~WatchListener() {}
+
+		// called from the watch thread, only when something changed
+		virtual void changed( const ChangeArray& changes) = 0;
+	};
+
+	class Watch
+	{
+	public:
+		Watch( const DeviceInstanceArray& devices, WatchListener& listener);
+		~Watch();
+
+		unsigned int interval() const { return iInterval; }
+		void setInterval( const unsigned int milliseconds) { iInterval = milliseconds; }
+
+		// fraction of one core the polling may use; the interval stretches to honour it
+		double cpuBudget() const { return iCpuBudget; }
+		void setCpuBudget( const double value) { iCpuBudget = value; }
+
+		// interval actually used after applying the budget
+		unsigned int effectiveInterval() const { return iEffectiveInterval; }
+
+		void start();
+		void stop();
+
+		// one synchronous pass against the previous values; the constructor reads the first ones
+		void poll( ChangeArray& changes);
+
+		// steady time spent in the reads of the last poll
+		std::chrono::steady_clock::duration probeTime() const { return iProbeTime; }
+
+	private:
+		Watch( const Watch&);
+		Watch& operator=( const Watch&);
+
+		class Field
+		{
+		public:
+			size_t	device;
+			uint	field;
+			ulong	value;
+		};
+
+		static bool readVolatile( ulong& value, const cl_device_id id, const uint field);
+
+		void work();
+
+		std::vector<cl_device_id>	iIds;
+		std::vector<Field>			iFields;
+		std::thread					iThread;
+		std::mutex					iMutex;
+		std::condition_variable		iWake;
+		WatchListener&				iListener;
+		std::atomic<double>			iCpuBudget;
+		std::atomic<unsigned int>	iInterval;
+		std::atomic<unsigned int>	iEffectiveInterval;
+		std::chrono::steady_clock::duration	iProbeTime;
+		bool						iStopping;
+	};
+}
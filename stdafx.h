@@ -7,6 +7,7 @@
 #include <string>
 #include <fstream>
 #include <cassert>
+#include <stdexcept>
 #include <unordered_map>
 #include <unordered_set>
 